@@ -12,16 +12,56 @@
 
 #include "buffer/buffer_pool_manager.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstring>
 #include <list>
+#include <new>
 #include <unordered_map>
+#include <vector>
+
+#include "common/logger.h"
 
 namespace bustub {
 
-BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
-  // We allocate a consecutive memory space for the buffer pool.
-  pages_ = new Page[pool_size_];
-  replacer_ = new ClockReplacer(pool_size);
+BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager,
+                                     ReplacerType replacer_type)
+    : BufferPoolManager(pool_size, 1, 0, disk_manager, log_manager, replacer_type) {}
+
+BufferPoolManager::BufferPoolManager(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
+                                     DiskManager *disk_manager, LogManager *log_manager, ReplacerType replacer_type)
+    : pool_size_(pool_size),
+      max_pool_size_(pool_size * BUFFER_POOL_MAX_GROWTH),
+      num_instances_(num_instances),
+      instance_index_(instance_index),
+      disk_manager_(disk_manager),
+      log_manager_(log_manager),
+      page_table_(max_pool_size_),
+      frame_states_(max_pool_size_),
+      frame_io_cv_(max_pool_size_) {
+  BUSTUB_ASSERT(num_instances > 0, "If BPM is not part of a pool, then the pool size should just be 1");
+  BUSTUB_ASSERT(instance_index < num_instances,
+                "BPM index cannot be greater than the number of BPMs in the pool. In non-parallel case, index should "
+                "just be 0.");
+  // The frames live in one page-aligned arena; shards of a parallel pool are spread over the NUMA nodes. Everything
+  // per frame is sized for max_pool_size_ so that Resize never has to move a page; untouched frames cost no memory.
+  int numa_nodes = FrameArena::GetNumaNodeCount();
+  int numa_node = num_instances > 1 && numa_nodes > 1 ? static_cast<int>(instance_index % numa_nodes) : -1;
+  arena_ = std::make_unique<FrameArena>(max_pool_size_, numa_node);
+  // The page objects that describe the frames are kept in a separate, cache-line aligned array.
+  pages_ = static_cast<Page *>(operator new[](max_pool_size_ * sizeof(Page), std::align_val_t{alignof(Page)}));
+  for (size_t i = 0; i < max_pool_size_; ++i) {
+    new (&pages_[i]) Page(arena_->GetFrameData(static_cast<frame_id_t>(i)));
+  }
+  switch (replacer_type) {
+    case ReplacerType::CLOCK:
+      replacer_ = new ClockReplacer(max_pool_size_);
+      break;
+    case ReplacerType::LRU_K:
+      replacer_ = new LRUKReplacer(max_pool_size_);
+      break;
+  }
 
   // Initially, every page is in the free list.
   for (size_t i = 0; i < pool_size_; ++i) {
@@ -29,124 +69,262 @@ BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager
   }
 }
 
+BufferPoolManager::BufferPoolManager(DiskManager *disk_manager, LogManager *log_manager)
+    : pool_size_(0),
+      max_pool_size_(0),
+      pages_(nullptr),
+      disk_manager_(disk_manager),
+      log_manager_(log_manager),
+      page_table_(0),
+      replacer_(nullptr) {}
+
 BufferPoolManager::~BufferPoolManager() {
-  delete[] pages_;
+  StopStatsDump();
+  StopPrefetchThread();
+  BufferPoolManager::StopBackgroundWriter();
+  if (pages_ != nullptr) {
+    for (size_t i = 0; i < max_pool_size_; ++i) {
+      pages_[i].~Page();
+    }
+    operator delete[](pages_, std::align_val_t{alignof(Page)});
+  }
   delete replacer_;
 }
 
-Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
+Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) { return FetchPageWithStrategyImpl(page_id, nullptr); }
+
+Page *BufferPoolManager::FetchPageWithStrategyImpl(page_id_t page_id, BufferAccessStrategy *strategy) {
+  // 0.     Try to pin P without the latch; this works for most hits.
   // 1.     Search the page table for the requested page (P).
-  // 1.1    If P exists, pin it and return it immediately.
-  // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
-  //        Note that pages are always found from the free list first.
-  // 2.     If R is dirty, write it back to the disk.
-  // 3.     Delete R from the page table and insert P.
-  // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-  std::lock_guard<std::mutex> guard(latch_);
-  Page *page;
-  if(page_id == INVALID_PAGE_ID){return nullptr;}
+  // 1.1    If P exists, pin it, wait for any I/O in progress on its frame and return it.
+  // 1.2    If P is still being written back by an eviction, wait for that write and search again.
+  // 1.3    If P does not exist, find a replacement page (R) from either the free list or the replacer.
+  //        Note that pages are always found from the free list first, unless the caller's ring has a frame to recycle.
+  // 2.     Delete R from the page table and insert P, so that concurrent fetchers of P wait on this frame.
+  // 3.     Drop the latch; write R back if it is dirty, then read in the page content from disk.
+  // 4.     Mark the frame ready, wake up its waiters and return a pointer to P. If P failed its checksum, drop it from
+  //        the page table, free the frame and return nullptr instead.
+  if (page_id == INVALID_PAGE_ID) {
+    return nullptr;
+  }
+  Page *resident = TryPinResident(page_id);
+  if (resident != nullptr) {
+    return resident;
+  }
+
+  std::unique_lock<std::mutex> lock = LockLatch();
+  while (true) {
+    frame_id_t frame_id;
+    if (page_table_.Find(page_id, &frame_id)) {
+      Page *page = &pages_[frame_id];
+      page->pin_count_++;
+      replacer_->Pin(frame_id);
+      stats_.Add(BufferPoolStatsCollector::HITS);
+      if (frame_states_[frame_id] != FrameState::READY) {
+        stats_.Add(BufferPoolStatsCollector::PIN_WAITS);
+      }
+      frame_io_cv_[frame_id].wait(lock, [&] { return frame_states_[frame_id] == FrameState::READY; });
+      if (page->page_id_ != page_id) {
+        // The page failed its checksum while we waited for it to be read in; its loader takes the frame back.
+        page->pin_count_--;
+        frame_io_cv_[frame_id].notify_all();
+        return nullptr;
+      }
+      return page;
+    }
+    auto writeback = writeback_table_.find(page_id);
+    if (writeback == writeback_table_.end()) {
+      break;
+    }
+    stats_.Add(BufferPoolStatsCollector::PIN_WAITS);
+    frame_io_cv_[writeback->second].wait(lock, [&] { return writeback_table_.count(page_id) == 0; });
+  }
+
+  frame_id_t frame_id;
+  page_id_t old_page_id;
+  bool old_is_dirty;
+  if (!AcquireFrame(strategy, &frame_id, &old_page_id, &old_is_dirty)) {
+    return nullptr;
+  }
+  Page *page = &pages_[frame_id];
+  // The frame still holds the victim's bytes. Mark it busy before the new mapping becomes visible, so that a
+  // TryPinResident that finds the mapping backs off instead of returning those bytes as the new page.
+  frame_states_[frame_id] = old_is_dirty ? FrameState::WRITING : FrameState::READING;
+  page_table_.Insert(page_id, frame_id);
+  page->page_id_ = page_id;
+  page->is_dirty_ = false;
+  page->pin_count_ = 1;
+
+  if (old_is_dirty) {
+    WriteBackFrame(&lock, frame_id, old_page_id);
+    frame_states_[frame_id] = FrameState::READING;
+  }
+  lock.unlock();
+  stats_.Add(BufferPoolStatsCollector::MISSES);
+  auto start = std::chrono::steady_clock::now();
+  bool intact = disk_manager_->ReadPage(page_id, page->GetData());
+  stats_.RecordRead(start);
+  lock.lock();
+  if (!intact) {
+    stats_.Add(BufferPoolStatsCollector::CHECKSUM_FAILURES);
+    DiscardFrame(&lock, frame_id);
+    return nullptr;
+  }
+  frame_states_[frame_id] = FrameState::READY;
+  frame_io_cv_[frame_id].notify_all();
+  return page;
+}
+
+Page *BufferPoolManager::TryPinResident(page_id_t page_id) {
   frame_id_t frame_id;
-  auto found = page_table_.find(page_id);
-  if(found != page_table_.end()){
-    frame_id = page_table_[page_id];
-    page = &pages_[frame_id];
+  if (!page_table_.Find(page_id, &frame_id)) {
+    return nullptr;
+  }
+  Page *page = &pages_[frame_id];
+  int pin_count = page->pin_count_.load();
+  do {
+    if (pin_count == FRAME_CLAIMED) {
+      return nullptr;
+    }
+  } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count + 1));
+
+  // The frame may have been given to another page between the lookup and the pin.
+  if (page->page_id_ == page_id && frame_states_[frame_id] == FrameState::READY) {
     replacer_->Pin(frame_id);
-    page->pin_count_++;
+    stats_.Add(BufferPoolStatsCollector::HITS);
     return page;
   }
-  if(!free_list_.empty()){
-    frame_id = free_list_.front();
-    page=&pages_[frame_id];
-    free_list_.erase(free_list_.begin());
-  }
-  else{
-    if(!replacer_->Victim(&frame_id))return nullptr;
-    page = &pages_[frame_id];
-    if(page->IsDirty()){
-      disk_manager_->WritePage(page->GetPageId(), page->GetData());
-      page->is_dirty_=false;
+  if (page->pin_count_.fetch_sub(1) == 1) {
+    // A frame that was about to be evicted or retired may have been skipped because of our pin; hand it back.
+    std::lock_guard<std::mutex> guard(latch_);
+    if (!IsRetired(frame_id) && page->pin_count_ == 0 && page->page_id_ != INVALID_PAGE_ID) {
+      replacer_->SetEvictable(frame_id, true);
     }
-    page_table_.erase(page->GetPageId());
+    // Resize and DiscardFrame wait for the frame to be unpinned.
+    frame_io_cv_[frame_id].notify_all();
   }
-  disk_manager_->ReadPage(page_id, page->GetData());
-  page_table_[page_id]=frame_id;
-  page->page_id_=page_id;
-  // std::cout<<"!!!!!"<<page->GetData()<<"!!!!!";
-  page->pin_count_++;
+  return nullptr;
+}
 
-  return page;
+BasicPageGuard BufferPoolManager::FetchPageBasic(page_id_t page_id, BufferAccessStrategy *strategy) {
+  return BasicPageGuard(this, FetchPageWithStrategy(page_id, strategy));
+}
+
+ReadPageGuard BufferPoolManager::FetchPageRead(page_id_t page_id, BufferAccessStrategy *strategy) {
+  return FetchPageBasic(page_id, strategy).UpgradeRead();
+}
+
+WritePageGuard BufferPoolManager::FetchPageWrite(page_id_t page_id) { return FetchPageBasic(page_id).UpgradeWrite(); }
+
+BasicPageGuard BufferPoolManager::NewPageGuarded(page_id_t *page_id) {
+  BasicPageGuard guard(this, NewPage(page_id));
+  guard.SetDirty();
+  return guard;
+}
+
+BasicPageGuard BufferPoolManager::NewReservedPageGuarded(page_id_t page_id) {
+  BasicPageGuard guard(this, NewReservedPageImpl(page_id));
+  guard.SetDirty();
+  return guard;
 }
 
 bool BufferPoolManager::UnpinPageImpl(page_id_t page_id, bool is_dirty) {
-  std::lock_guard<std::mutex> guard(latch_);
+  std::unique_lock<std::mutex> lock = LockLatch();
   frame_id_t frame_id;
   Page *page = nullptr;
-  if(page_table_.find(page_id) == page_table_.end()){
-    // std::cout<<"find:false";
+  if (!page_table_.Find(page_id, &frame_id)) {
     return false;
   }
-  frame_id = page_table_[page_id];
   page = &pages_[frame_id];
   if(page->pin_count_<1)return false;
-  page->pin_count_--;
-  if(page->pin_count_==0){
-    replacer_->Unpin(frame_id);
+  if (--page->pin_count_ == 0) {
+    if (IsRetired(frame_id)) {
+      frame_io_cv_[frame_id].notify_all();
+    } else {
+      replacer_->Unpin(frame_id);
+    }
   }
   if(is_dirty)page->is_dirty_=true;
   return true; 
   }
 
 bool BufferPoolManager::FlushPageImpl(page_id_t page_id) {
-  std::lock_guard<std::mutex> guard(latch_);
-  frame_id_t frame_id;
-  Page *page=nullptr;
-  if(page_id == INVALID_PAGE_ID){return false;}
-  if(page_table_.find(page_id) == page_table_.end()){
+  // Make sure you call DiskManager::WritePage!
+  if (page_id == INVALID_PAGE_ID) {
     return false;
   }
-  frame_id = page_table_[page_id];
-  page = &pages_[frame_id];
-  disk_manager_->WritePage(page_id, page->GetData());
-  page->is_dirty_=false;
-  return true;
-  
-  // Make sure you call DiskManager::WritePage!
+  std::unique_lock<std::mutex> lock = LockLatch();
+  while (true) {
+    frame_id_t frame_id;
+    if (!page_table_.Find(page_id, &frame_id)) {
+      return false;
+    }
+    if (frame_states_[frame_id] == FrameState::READY) {
+      // Hold the frame and write with the latch dropped, as WriteDirtyPages does. The read latch keeps writers from
+      // changing the page halfway through the write.
+      Page *page = &pages_[frame_id];
+      HoldFrameForWrite(frame_id);
+      lock.unlock();
+      page->RLatch();
+      auto start = std::chrono::steady_clock::now();
+      disk_manager_->WritePage(page_id, page->GetData());
+      stats_.RecordWrite(start);
+      page->RUnlatch();
+      lock.lock();
+      ReleaseFrame(frame_id);
+      return true;
+    }
+    // The frame does not hold the page's contents yet; the page may have moved by the time we wake up.
+    frame_io_cv_[frame_id].wait(lock);
+  }
 }
 
 Page *BufferPoolManager::NewPageImpl(page_id_t *page_id) {
   // 0.   Make sure you call DiskManager::AllocatePage!
   // 1.   If all the pages in the buffer pool are pinned, return nullptr.
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
-  // 3.   Update P's metadata, zero out memory and add P to the page table.
-  // 4.   Set the page ID output parameter. Return a pointer to P.
-  std::lock_guard<std::mutex> guard(latch_);
-  frame_id_t frame_id;
-  Page *page=nullptr;
-  if(!free_list_.empty()){
-    frame_id = free_list_.front();
-    // std::cout<<"--new:"<<frame_id<<"--";
-    page=&pages_[frame_id];
-    free_list_.erase(free_list_.begin()); 
-  }
-  else{
-    if(!replacer_->Victim(&frame_id)){
+  // 3.   Update P's metadata and add P to the page table, writing the victim back with the latch dropped.
+  // 4.   Zero out memory, set the page ID output parameter and return a pointer to P.
+  return CreatePage(page_id, true);
+}
+
+Page *BufferPoolManager::NewReservedPageImpl(page_id_t page_id) { return CreatePage(&page_id, false); }
+
+Page *BufferPoolManager::CreatePage(page_id_t *page_id, bool allocate) {
+  if (allocate) {
+    // Allocating writes the free-space map, so it is done before the latch is taken.
+    *page_id = AllocatePage();
+    if (*page_id == INVALID_PAGE_ID) {
       return nullptr;
     }
-    page = &pages_[frame_id];
-    if(page->is_dirty_){
-      disk_manager_->WritePage(page->GetPageId(), page->GetData());
-      page->is_dirty_=false;
+  }
+  std::unique_lock<std::mutex> lock = LockLatch();
+  // A deleted page's id can come back while its last eviction is still writing the old contents.
+  WaitForWriteBack(&lock, *page_id);
+  frame_id_t frame_id;
+  page_id_t old_page_id;
+  bool old_is_dirty;
+  if (!AcquireFrame(nullptr, &frame_id, &old_page_id, &old_is_dirty)) {
+    lock.unlock();
+    if (allocate) {
+      disk_manager_->DeallocatePage(*page_id);
     }
-    page_table_.erase(page->GetPageId());
+    return nullptr;
+  }
+  Page *page = &pages_[frame_id];
+  // As on a fetch miss, the frame is busy until its memory is reset.
+  frame_states_[frame_id] = old_is_dirty ? FrameState::WRITING : FrameState::READING;
+  page_table_.Insert(*page_id, frame_id);
+  page->page_id_ = *page_id;
+  page->is_dirty_ = true;
+  page->pin_count_ = 1;
+
+  if (old_is_dirty) {
+    WriteBackFrame(&lock, frame_id, old_page_id);
   }
-  
-  *page_id = disk_manager_->AllocatePage();
-  // std::cout<<"new page id: "<<*page_id<<"--";
-  page_table_[*page_id]=frame_id;
   page->ResetMemory();
-  page->page_id_=*page_id;
-  page->is_dirty_=true;
-  page->pin_count_++;
+  frame_states_[frame_id] = FrameState::READY;
+  frame_io_cv_[frame_id].notify_all();
   return page;
 }
 
@@ -156,37 +334,475 @@ bool BufferPoolManager::DeletePageImpl(page_id_t page_id) {
   // 1.   If P does not exist, return true.
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-  std::lock_guard<std::mutex> guard(latch_);
+  std::unique_lock<std::mutex> lock = LockLatch();
   frame_id_t frame_id;
   Page *page=nullptr;
-  if(page_table_.find(page_id)==page_table_.end()){disk_manager_->DeallocatePage(page_id); return true;}
-  frame_id = page_table_[page_id];
+  // An evicted page may still be on its way to disk; its id must not be freed under that write.
+  WaitForWriteBack(&lock, page_id);
+  if (!page_table_.Find(page_id, &frame_id)) {
+    lock.unlock();
+    disk_manager_->DeallocatePage(page_id);
+    return true;
+  }
   page = &pages_[frame_id];
-  if(page->pin_count_>0){return false;}
-  replacer_->Pin(frame_id);
-  page_table_.erase(page->GetPageId());
-  free_list_.push_back(frame_id);
+  if (!ClaimFrame(frame_id)) {
+    return false;
+  }
+  replacer_->Remove(frame_id);
+  page_table_.Erase(page_id);
+  if (IsRetired(frame_id)) {
+    frame_io_cv_[frame_id].notify_all();
+  } else {
+    free_list_.push_back(frame_id);
+  }
   page->page_id_=INVALID_PAGE_ID;
   page->is_dirty_=false;
   page->ResetMemory();
+  page->pin_count_ = 0;
 
+  // Deallocating writes the free-space map, so it is done with the latch dropped.
+  lock.unlock();
   disk_manager_->DeallocatePage(page_id);
 
   return true;
 }
 
 void BufferPoolManager::FlushAllPagesImpl() {
-  // You can do it!
+  std::vector<DirtyPage> pages;
+  HoldDirtyPages(&pages);
+  WriteDirtyPages(&pages);
+}
+
+void BufferPoolManager::HoldDirtyPages(std::vector<DirtyPage> *pages) {
   std::lock_guard<std::mutex> guard(latch_);
-  frame_id_t frame_id;
-  Page *page=nullptr;
-  for(auto iter=page_table_.begin(); iter!=page_table_.end();iter++){
-    frame_id = iter->second;
-    page = &pages_[frame_id];
-    page_table_.erase(iter->first);
-    disk_manager_->WritePage(iter->first, page->GetData());
-    page->is_dirty_=false;
+  page_table_.ForEach([&](page_id_t page_id, frame_id_t frame_id) {
+    // Frames with I/O in flight hold either a page being read in or the old contents of a reused frame.
+    if (frame_states_[frame_id] == FrameState::READY && pages_[frame_id].is_dirty_) {
+      HoldFrameForWrite(frame_id);
+      pages->push_back({page_id, this, frame_id});
+    }
+  });
+}
+
+void BufferPoolManager::WriteDirtyPages(std::vector<DirtyPage> *pages) {
+  std::sort(pages->begin(), pages->end(),
+            [](const DirtyPage &a, const DirtyPage &b) { return a.page_id_ < b.page_id_; });
+
+  if (pages->empty()) {
+    return;
+  }
+  // Page-aligned, so the vectored writes also work with direct I/O.
+  FrameArena staging(std::min<size_t>(pages->size(), FLUSH_BATCH_SIZE));
+  std::vector<const char *> run;
+  for (size_t batch = 0; batch < pages->size(); batch += FLUSH_BATCH_SIZE) {
+    size_t batch_end = std::min<size_t>(batch + FLUSH_BATCH_SIZE, pages->size());
+    for (size_t i = batch; i < batch_end; ++i) {
+      Page *page = &(*pages)[i].pool_->pages_[(*pages)[i].frame_id_];
+      char *copy = staging.GetFrameData(static_cast<frame_id_t>(i - batch));
+      page->RLatch();
+      memcpy(copy, page->GetData(), PAGE_SIZE);
+      page->RUnlatch();
+
+      run.push_back(copy);
+      if (i + 1 == batch_end || (*pages)[i + 1].page_id_ != (*pages)[i].page_id_ + 1) {
+        auto start = std::chrono::steady_clock::now();
+        disk_manager_->WritePages((*pages)[i + 1 - run.size()].page_id_, run.data(), run.size());
+        stats_.RecordWrite(start);
+        run.clear();
+      }
+    }
+    for (size_t i = batch; i < batch_end; ++i) {
+      BufferPoolManager *pool = (*pages)[i].pool_;
+      std::lock_guard<std::mutex> guard(pool->latch_);
+      pool->ReleaseFrame((*pages)[i].frame_id_);
+    }
+  }
+  disk_manager_->SyncPages();
+}
+
+void BufferPoolManager::HoldFrameForWrite(frame_id_t frame_id) {
+  Page *page = &pages_[frame_id];
+  page->pin_count_++;
+  replacer_->SetEvictable(frame_id, false);
+  page->is_dirty_ = false;
+}
+
+void BufferPoolManager::ReleaseFrame(frame_id_t frame_id) {
+  if (--pages_[frame_id].pin_count_ == 0) {
+    if (IsRetired(frame_id)) {
+      frame_io_cv_[frame_id].notify_all();
+    } else {
+      replacer_->SetEvictable(frame_id, true);
+    }
+  }
+}
+
+bool BufferPoolManager::AcquireFrame(BufferAccessStrategy *strategy, frame_id_t *frame_id, page_id_t *old_page_id,
+                                     bool *old_is_dirty) {
+  std::unique_lock<std::mutex> ring_lock;
+  BufferAccessStrategy::RingSlot *slot = nullptr;
+  if (strategy != nullptr) {
+    ring_lock = std::unique_lock<std::mutex>(strategy->latch_);
+    slot = strategy->NextSlot();
+  }
+
+  bool found = false;
+  if (slot != nullptr && slot->first == this && !IsRetired(slot->second) &&
+      pages_[slot->second].page_id_ != INVALID_PAGE_ID && frame_states_[slot->second] == FrameState::READY &&
+      ClaimFrame(slot->second)) {
+    // The ring's frame is unpinned and still holds the page we put there (or one another thread loaded into it),
+    // which means it is sitting in the replacer. Take it out and forget its history.
+    *frame_id = slot->second;
+    replacer_->Remove(*frame_id);
+    found = true;
+  }
+  for (size_t i = free_list_.size(); !found && i > 0; --i) {
+    frame_id_t free_frame_id = free_list_.front();
+    free_list_.pop_front();
+    if (ClaimFrame(free_frame_id)) {
+      *frame_id = free_frame_id;
+      found = true;
+    } else {
+      // A TryPinResident with a stale page table entry holds the frame for a moment.
+      free_list_.push_back(free_frame_id);
+    }
   }
+  // A victim that TryPinResident pinned after the replacer chose it is passed over. It goes back to the replacer, with
+  // its access history, when that pin is released.
+  while (!found && replacer_->Victim(frame_id)) {
+    if (ClaimFrame(*frame_id)) {
+      // Only now that the frame is ours does the replacer forget the access history of its old page.
+      replacer_->Remove(*frame_id);
+      found = true;
+    }
+  }
+  if (!found) {
+    return false;
+  }
+
+  Page *page = &pages_[*frame_id];
+  *old_page_id = page->page_id_;
+  *old_is_dirty = page->is_dirty_;
+  if (*old_is_dirty) {
+    // The background writer (if any) has fallen behind.
+    bg_writer_cv_.notify_one();
+    stats_.Add(BufferPoolStatsCollector::DIRTY_EVICTIONS);
+  }
+  if (page->page_id_ != INVALID_PAGE_ID) {
+    page_table_.Erase(page->page_id_);
+    stats_.Add(BufferPoolStatsCollector::EVICTIONS);
+  }
+  if (slot != nullptr) {
+    *slot = {this, *frame_id};
+  }
+  // Loading the new page counts as its first access.
+  replacer_->Pin(*frame_id);
+  return true;
+}
+
+void BufferPoolManager::DiscardFrame(std::unique_lock<std::mutex> *lock, frame_id_t frame_id) {
+  Page *page = &pages_[frame_id];
+  page_table_.Erase(page->page_id_);
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  page->ResetMemory();
+  frame_states_[frame_id] = FrameState::READY;
+  page->pin_count_--;
+  // Fetchers that waited for the page see that the frame no longer holds it and drop their pins.
+  frame_io_cv_[frame_id].notify_all();
+  frame_io_cv_[frame_id].wait(*lock, [&] { return IsRetired(frame_id) || ClaimFrame(frame_id); });
+  if (IsRetired(frame_id)) {
+    // Resize takes the frame.
+    return;
+  }
+  replacer_->Remove(frame_id);
+  free_list_.push_back(frame_id);
+  page->pin_count_ = 0;
+}
+
+void BufferPoolManager::WriteBackFrame(std::unique_lock<std::mutex> *lock, frame_id_t frame_id,
+                                       page_id_t old_page_id) {
+  writeback_table_[old_page_id] = frame_id;
+  frame_states_[frame_id] = FrameState::WRITING;
+  lock->unlock();
+  auto start = std::chrono::steady_clock::now();
+  disk_manager_->WritePage(old_page_id, pages_[frame_id].GetData());
+  stats_.RecordWrite(start);
+  lock->lock();
+  writeback_table_.erase(old_page_id);
+  frame_io_cv_[frame_id].notify_all();
+}
+
+void BufferPoolManager::WaitForWriteBack(std::unique_lock<std::mutex> *lock, page_id_t page_id) {
+  auto writeback = writeback_table_.find(page_id);
+  if (writeback == writeback_table_.end()) {
+    return;
+  }
+  stats_.Add(BufferPoolStatsCollector::PIN_WAITS);
+  frame_io_cv_[writeback->second].wait(*lock, [&] { return writeback_table_.count(page_id) == 0; });
+}
+
+bool BufferPoolManager::Resize(size_t new_size) {
+  if (new_size == 0 || new_size > max_pool_size_) {
+    return false;
+  }
+  std::lock_guard<std::mutex> resize_guard(resize_latch_);
+  std::unique_lock<std::mutex> lock(latch_);
+  size_t old_size = pool_size_;
+  if (new_size >= old_size) {
+    for (size_t i = old_size; i < new_size; ++i) {
+      free_list_.push_back(static_cast<frame_id_t>(i));
+    }
+    pool_size_ = new_size;
+    return true;
+  }
+
+  // From now on the frames past new_size are retired: they are taken off the free list and out of the replacer, and
+  // nothing hands them out again. Pages in them can still be fetched until Resize gets to their frame.
+  pool_size_ = new_size;
+  free_list_.remove_if([&](frame_id_t frame_id) { return IsRetired(frame_id); });
+  for (size_t i = new_size; i < old_size; ++i) {
+    replacer_->Remove(static_cast<frame_id_t>(i));
+  }
+  bg_writer_cursor_ = 0;
+
+  for (size_t i = new_size; i < old_size; ++i) {
+    auto frame_id = static_cast<frame_id_t>(i);
+    Page *page = &pages_[frame_id];
+    // Unpinning a retired frame signals its condition variable, and so does the end of an I/O. The frame is claimed as
+    // soon as it is idle, so that no pin can sneak in while its page is dropped.
+    frame_io_cv_[frame_id].wait(
+        lock, [&] { return frame_states_[frame_id] == FrameState::READY && ClaimFrame(frame_id); });
+    page_id_t page_id = page->page_id_;
+    if (page_id != INVALID_PAGE_ID) {
+      page_table_.Erase(page_id);
+      if (page->is_dirty_) {
+        WriteBackFrame(&lock, frame_id, page_id);
+        frame_states_[frame_id] = FrameState::READY;
+      }
+    }
+    page->page_id_ = INVALID_PAGE_ID;
+    page->is_dirty_ = false;
+    page->pin_count_ = 0;
+  }
+  lock.unlock();
+
+  // No one can reach the retired frames any more.
+  arena_->Release(static_cast<frame_id_t>(new_size), old_size - new_size);
+  return true;
+}
+
+std::unique_lock<std::mutex> BufferPoolManager::LockLatch() {
+  std::unique_lock<std::mutex> lock(latch_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    // Only contended acquisitions pay for reading the clock.
+    auto start = std::chrono::steady_clock::now();
+    lock.lock();
+    stats_.Add(BufferPoolStatsCollector::LATCH_WAITS);
+    stats_.Add(BufferPoolStatsCollector::LATCH_WAIT_NANOS,
+               std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+  }
+  return lock;
+}
+
+BufferPoolStats BufferPoolManager::GetStats() {
+  BufferPoolStats stats;
+  stats_.Collect(&stats);
+  std::lock_guard<std::mutex> guard(latch_);
+  stats.pool_size_ = pool_size_;
+  stats.resident_pages_ = page_table_.Size();
+  stats.free_frames_ = free_list_.size();
+  for (size_t i = 0; i < pool_size_; ++i) {
+    if (pages_[i].page_id_ != INVALID_PAGE_ID && pages_[i].is_dirty_) {
+      stats.dirty_pages_++;
+    }
+  }
+  return stats;
+}
+
+void BufferPoolManager::StartStatsDump() {
+  std::lock_guard<std::mutex> guard(stats_dump_latch_);
+  if (stats_dump_thread_ != nullptr) {
+    return;
+  }
+  stop_stats_dump_ = false;
+  stats_dump_thread_ = new std::thread(&BufferPoolManager::RunStatsDump, this);
+}
+
+void BufferPoolManager::StopStatsDump() {
+  std::thread *stats_dump_thread;
+  {
+    std::lock_guard<std::mutex> guard(stats_dump_latch_);
+    stop_stats_dump_ = true;
+    stats_dump_thread = stats_dump_thread_;
+    stats_dump_thread_ = nullptr;
+    stats_dump_cv_.notify_all();
+  }
+  if (stats_dump_thread != nullptr) {
+    stats_dump_thread->join();
+    delete stats_dump_thread;
+  }
+}
+
+void BufferPoolManager::RunStatsDump() {
+  std::unique_lock<std::mutex> lock(stats_dump_latch_);
+  while (!stats_dump_cv_.wait_for(lock, stats_dump_interval, [&] { return stop_stats_dump_; })) {
+    lock.unlock();
+    LOG_INFO("buffer pool stats: %s", GetStats().ToString().c_str());
+    lock.lock();
+  }
+}
+
+void BufferPoolManager::StartBackgroundWriter(double target_clean_fraction) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (bg_writer_thread_ != nullptr) {
+    return;
+  }
+  bg_writer_target_clean_ = target_clean_fraction;
+  stop_bg_writer_ = false;
+  bg_writer_thread_ = new std::thread(&BufferPoolManager::RunBackgroundWriter, this);
+}
+
+void BufferPoolManager::StopBackgroundWriter() {
+  std::thread *bg_writer_thread;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    stop_bg_writer_ = true;
+    bg_writer_thread = bg_writer_thread_;
+    bg_writer_thread_ = nullptr;
+    bg_writer_cv_.notify_all();
+  }
+  if (bg_writer_thread != nullptr) {
+    bg_writer_thread->join();
+    delete bg_writer_thread;
+  }
+}
+
+void BufferPoolManager::RunBackgroundWriter() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (!stop_bg_writer_) {
+    std::vector<frame_id_t> frames = PickFramesToClean();
+    if (frames.empty()) {
+      bg_writer_cv_.wait_for(lock, bg_writer_interval);
+      continue;
+    }
+
+    lock.unlock();
+    for (frame_id_t frame_id : frames) {
+      // The read latch keeps writers from changing the page halfway through the write.
+      Page *page = &pages_[frame_id];
+      page->RLatch();
+      auto start = std::chrono::steady_clock::now();
+      disk_manager_->WritePage(page->GetPageId(), page->GetData());
+      stats_.RecordWrite(start);
+      page->RUnlatch();
+    }
+    lock.lock();
+
+    for (frame_id_t frame_id : frames) {
+      ReleaseFrame(frame_id);
+    }
+  }
+}
+
+std::vector<frame_id_t> BufferPoolManager::PickFramesToClean() {
+  auto target = static_cast<size_t>(std::ceil(bg_writer_target_clean_ * pool_size_));
+  size_t clean = free_list_.size();
+  for (size_t i = 0; i < pool_size_; ++i) {
+    const Page &page = pages_[i];
+    if (page.page_id_ != INVALID_PAGE_ID && page.pin_count_ == 0 && !page.is_dirty_) {
+      clean++;
+    }
+  }
+
+  std::vector<frame_id_t> frames;
+  bool check_wal = enable_logging && log_manager_ != nullptr;
+  for (size_t i = 0; i < pool_size_ && clean + frames.size() < target; ++i) {
+    auto frame_id = static_cast<frame_id_t>(bg_writer_cursor_);
+    bg_writer_cursor_ = (bg_writer_cursor_ + 1) % pool_size_;
+    Page *page = &pages_[frame_id];
+    if (page->page_id_ == INVALID_PAGE_ID || page->pin_count_ != 0 || !page->is_dirty_ ||
+        frame_states_[frame_id] != FrameState::READY) {
+      continue;
+    }
+    // WAL: the log records that produced the page must reach the disk before the page does.
+    if (check_wal && page->GetLSN() > log_manager_->GetPersistentLSN()) {
+      continue;
+    }
+    HoldFrameForWrite(frame_id);
+    frames.push_back(frame_id);
+  }
+  return frames;
+}
+
+void BufferPoolManager::PrefetchPageImpl(PrefetchRequest request) {
+  if (request.page_id_ == INVALID_PAGE_ID || request.chain_length_ == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(prefetch_latch_);
+  if (stop_prefetch_ || prefetch_queue_.size() >= pool_size_) {
+    return;
+  }
+  if (prefetch_thread_ == nullptr) {
+    prefetch_thread_ = new std::thread(&BufferPoolManager::RunPrefetchThread, this);
+  }
+  prefetch_queue_.push_back(std::move(request));
+  prefetch_cv_.notify_one();
+}
+
+void BufferPoolManager::RunPrefetchThread() {
+  while (true) {
+    PrefetchRequest request;
+    {
+      std::unique_lock<std::mutex> lock(prefetch_latch_);
+      prefetch_cv_.wait(lock, [&] { return stop_prefetch_ || !prefetch_queue_.empty(); });
+      if (stop_prefetch_) {
+        return;
+      }
+      request = std::move(prefetch_queue_.front());
+      prefetch_queue_.pop_front();
+    }
+
+    // Going through the normal fetch path takes care of pages that are already resident or in flight.
+    Page *page = FetchPageWithStrategyImpl(request.page_id_, request.strategy_.get());
+    if (page == nullptr) {
+      // Every frame is pinned; the rest of the chain would not fit either.
+      continue;
+    }
+    page_id_t next_page_id = INVALID_PAGE_ID;
+    if (request.chain_length_ > 1 && request.next_page_id_ != nullptr) {
+      page->RLatch();
+      next_page_id = request.next_page_id_(page);
+      page->RUnlatch();
+    }
+    UnpinPageImpl(request.page_id_, false);
+
+    if (next_page_id != INVALID_PAGE_ID) {
+      request.page_id_ = next_page_id;
+      request.chain_length_--;
+      request.pool_->PrefetchPageImpl(std::move(request));
+    }
+  }
+}
+
+void BufferPoolManager::StopPrefetchThread() {
+  std::thread *prefetch_thread;
+  {
+    std::lock_guard<std::mutex> guard(prefetch_latch_);
+    stop_prefetch_ = true;
+    prefetch_thread = prefetch_thread_;
+    prefetch_thread_ = nullptr;
+    prefetch_cv_.notify_all();
+  }
+  if (prefetch_thread != nullptr) {
+    prefetch_thread->join();
+    delete prefetch_thread;
+  }
+}
+
+page_id_t BufferPoolManager::AllocatePage() {
+  // Shards only take page ids congruent to their index, so that page_id % num_instances_ always names the owner.
+  return disk_manager_->AllocatePage(num_instances_, instance_index_);
 }
 
 }  // namespace bustub
@@ -0,0 +1,125 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.cpp
+//
+// Identification: src/buffer/buffer_pool_stats.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace bustub {
+
+size_t LatencyHistogram::BucketOf(uint64_t nanos) {
+  uint64_t micros = nanos / 1000;
+  size_t bucket = 0;
+  while (micros != 0 && bucket + 1 < NUM_BUCKETS) {
+    micros >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other) {
+  for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  total_nanos_ += other.total_nanos_;
+}
+
+uint64_t LatencyHistogram::PercentileMicros(double fraction) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  auto wanted = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * count_)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+    seen += buckets_[i];
+    if (seen >= wanted) {
+      return 1ULL << i;
+    }
+  }
+  return 1ULL << (NUM_BUCKETS - 1);
+}
+
+void BufferPoolStats::Merge(const BufferPoolStats &other) {
+  hits_ += other.hits_;
+  misses_ += other.misses_;
+  evictions_ += other.evictions_;
+  dirty_evictions_ += other.dirty_evictions_;
+  pin_waits_ += other.pin_waits_;
+  latch_waits_ += other.latch_waits_;
+  latch_wait_nanos_ += other.latch_wait_nanos_;
+  checksum_failures_ += other.checksum_failures_;
+  read_latency_.Merge(other.read_latency_);
+  write_latency_.Merge(other.write_latency_);
+  pool_size_ += other.pool_size_;
+  resident_pages_ += other.resident_pages_;
+  free_frames_ += other.free_frames_;
+  dirty_pages_ += other.dirty_pages_;
+}
+
+std::string BufferPoolStats::ToString() const {
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(3) << "frames=" << pool_size_ << " resident=" << resident_pages_
+     << " free=" << free_frames_ << " dirty=" << dirty_pages_ << " hits=" << hits_ << " misses=" << misses_
+     << " hit_ratio=" << HitRatio() << " evictions=" << evictions_ << " dirty_evictions=" << dirty_evictions_
+     << " pin_waits=" << pin_waits_ << " latch_waits=" << latch_waits_
+     << " latch_wait_ms=" << static_cast<double>(latch_wait_nanos_) / 1e6 << " reads=" << read_latency_.count_
+     << " read_us(mean/p99)=" << read_latency_.MeanMicros() << "/" << read_latency_.PercentileMicros(0.99)
+     << " writes=" << write_latency_.count_ << " write_us(mean/p99)=" << write_latency_.MeanMicros() << "/"
+     << write_latency_.PercentileMicros(0.99) << " checksum_failures=" << checksum_failures_;
+  return os.str();
+}
+
+BufferPoolStatsCollector::Stripe &BufferPoolStatsCollector::GetStripe() {
+  static std::atomic<size_t> next_stripe{0};
+  thread_local size_t stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % NUM_STRIPES;
+  return stripes_[stripe];
+}
+
+void BufferPoolStatsCollector::Record(StripeHistogram *histogram, std::chrono::steady_clock::time_point start) {
+  auto nanos = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+  histogram->buckets_[LatencyHistogram::BucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+  histogram->total_nanos_.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+void BufferPoolStatsCollector::Collect(BufferPoolStats *stats) const {
+  std::array<uint64_t, NUM_COUNTERS> counters{};
+  auto collect_histogram = [](const StripeHistogram &from, LatencyHistogram *to) {
+    for (size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+      uint64_t count = from.buckets_[i].load(std::memory_order_relaxed);
+      to->buckets_[i] += count;
+      to->count_ += count;
+    }
+    to->total_nanos_ += from.total_nanos_.load(std::memory_order_relaxed);
+  };
+  for (const Stripe &stripe : stripes_) {
+    for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+      counters[i] += stripe.counters_[i].load(std::memory_order_relaxed);
+    }
+    collect_histogram(stripe.reads_, &stats->read_latency_);
+    collect_histogram(stripe.writes_, &stats->write_latency_);
+  }
+  stats->hits_ += counters[HITS];
+  stats->misses_ += counters[MISSES];
+  stats->evictions_ += counters[EVICTIONS];
+  stats->dirty_evictions_ += counters[DIRTY_EVICTIONS];
+  stats->pin_waits_ += counters[PIN_WAITS];
+  stats->latch_waits_ += counters[LATCH_WAITS];
+  stats->latch_wait_nanos_ += counters[LATCH_WAIT_NANOS];
+  stats->checksum_failures_ += counters[CHECKSUM_FAILURES];
+}
+
+}  // namespace bustub
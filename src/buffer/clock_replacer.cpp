@@ -11,80 +11,62 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/clock_replacer.h"
-#include <iostream>
 
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {
-    num_page = num_pages;
-}
+ClockReplacer::ClockReplacer(size_t num_pages) : num_frames_(num_pages), frames_(num_pages) {}
 
 ClockReplacer::~ClockReplacer() = default;
 
-bool ClockReplacer::Victim(frame_id_t *frame_id) { 
-    std::lock_guard<std::mutex> guard(mtx);
-    if(lst.size()==0){frame_id = nullptr; return false;}
-    *frame_id = lst[0];
-    hash[*frame_id]=false;
-    lst.erase(lst.begin());
-    return true;
+bool ClockReplacer::Victim(frame_id_t *frame_id) {
+  // Two full sweeps are enough to find a victim if the clock does not change under us: the first one clears every
+  // reference bit. Concurrent unpins may set them again, so keep sweeping while the clock is non-empty.
+  while (size_.load() > 0) {
+    for (size_t i = 0; i < 2 * num_frames_; ++i) {
+      size_t pos = clock_hand_.fetch_add(1) % num_frames_;
+      std::atomic<uint8_t> &state = frames_[pos];
+      uint8_t old_state = state.load();
+      if ((old_state & IN_CLOCK) == 0) {
+        continue;
+      }
+      if ((old_state & REFERENCED) != 0) {
+        // Give the frame a second chance. If the CAS fails, someone else changed the frame and the hand moves on.
+        state.compare_exchange_strong(old_state, old_state & ~REFERENCED);
+        continue;
+      }
+      if (state.compare_exchange_strong(old_state, 0)) {
+        size_.fetch_sub(1);
+        *frame_id = static_cast<frame_id_t>(pos);
+        return true;
+      }
+    }
+  }
+  return false;
 }
 
 void ClockReplacer::Pin(frame_id_t frame_id) {
-    std::lock_guard<std::mutex> guard(mtx);
-    if(find(lst.begin(), lst.end(), frame_id)!= lst.end()){
-        ref = distance(lst.begin(), find(lst.begin(), lst.end(), frame_id));
-        hash[frame_id]=false;
-        lst.erase(lst.begin()+ref);
-        if(ref==lst.size())ref=0;
-
-    }
-    // std::cout<<"Pin"<<ref;
-
+  if ((frames_[frame_id].exchange(0) & IN_CLOCK) != 0) {
+    size_.fetch_sub(1);
+  }
 }
 
 void ClockReplacer::Unpin(frame_id_t frame_id) {
-    std::lock_guard<std::mutex> guard(mtx);
-    if(find(lst.begin(), lst.end(), frame_id)==lst.end() && lst.size()<num_page){
-        lst.push_back(frame_id);
-        ref = distance(lst.begin(), find(lst.begin(), lst.end(), frame_id));
-        hash[frame_id]= true;
-        // std::cout<<"---A--"<<ref;
-    }
-    else if(find(lst.begin(), lst.end(), frame_id)==lst.end()){
-        temp = lst[ref];
-        while(hash[temp]){
-            hash[temp]=false;
-            if(ref<num_page-1){ref++;}
-            else{ref=0;}
-            temp = lst[ref];
-        }
-        hash[frame_id]=true;
-        lst[ref]=frame_id;
-        ref = distance(lst.begin(), find(lst.begin(), lst.end(), frame_id));
-        // std::cout<<"---B--"<<ref;
-    }
-    else{
-        if(hash[frame_id]){
-            ref = distance(lst.begin(), find(lst.begin(), lst.end(), frame_id));
-            // std::cout<<"---C---"<<ref;
-            }
-        else{
-            hash[frame_id]=true;
-            ref = distance(lst.begin(), find(lst.begin(), lst.end(), frame_id));
-            // std::cout<<"---D---"<<ref;
-        }
-        
+  if ((frames_[frame_id].fetch_or(IN_CLOCK | REFERENCED) & IN_CLOCK) == 0) {
+    size_.fetch_add(1);
+  }
+}
 
+void ClockReplacer::SetEvictable(frame_id_t frame_id, bool evictable) {
+  // Only the clock bit changes: the reference bit is left as it was, so the frame keeps its place in the rotation.
+  if (evictable) {
+    if ((frames_[frame_id].fetch_or(IN_CLOCK) & IN_CLOCK) == 0) {
+      size_.fetch_add(1);
     }
-    
-
+  } else if ((frames_[frame_id].fetch_and(static_cast<uint8_t>(~IN_CLOCK)) & IN_CLOCK) != 0) {
+    size_.fetch_sub(1);
+  }
 }
 
-size_t ClockReplacer::Size() { 
-    std::lock_guard<std::mutex> guard(mtx);
-    // std::cout<<"size:"<<lst.size();
-    return lst.size();
-}
+size_t ClockReplacer::Size() { return size_.load(); }
 
 }  // namespace bustub
@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.cpp
+//
+// Identification: src/buffer/frame_arena.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_arena.h"
+
+#include <dirent.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+FrameArena::FrameArena(size_t num_frames, int numa_node) : size_(std::max<size_t>(num_frames, 1) * PAGE_SIZE) {
+  bool large = size_ >= HUGE_PAGE_SIZE;
+  if (large) {
+    size_ = (size_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  }
+
+  void *data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (large) {
+    // Only succeeds if the administrator reserved enough huge pages (vm.nr_hugepages).
+    data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    huge_pages_ = data != MAP_FAILED;
+  }
+#endif
+  if (data == MAP_FAILED) {
+    data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+      throw Exception("can't map buffer pool frames");
+    }
+#ifdef MADV_HUGEPAGE
+    if (large) {
+      madvise(data, size_, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  data_ = static_cast<char *>(data);
+
+#ifdef __linux__
+  if (numa_node >= 0 && numa_node < static_cast<int>(sizeof(unsigned long) * 8)) {  // NOLINT
+    // MPOL_PREFERRED: allocate on the node while it has memory, fall back to the others. Nothing has been touched yet,
+    // so the policy applies to every page of the arena. Called through syscall to avoid depending on libnuma.
+    const int mpol_preferred = 1;
+    unsigned long node_mask = 1UL << numa_node;  // NOLINT
+    if (syscall(SYS_mbind, data_, size_, mpol_preferred, &node_mask, sizeof(node_mask) * 8, 0) != 0) {
+      LOG_DEBUG("failed to bind buffer pool frames to NUMA node %d", numa_node);
+    }
+  }
+#endif
+}
+
+FrameArena::~FrameArena() { munmap(data_, size_); }
+
+void FrameArena::Release(frame_id_t first_frame, size_t num_frames) {
+  // Only a hint: if the kernel refuses (e.g. for part of a huge page), the memory simply stays resident.
+  madvise(GetFrameData(first_frame), num_frames * PAGE_SIZE, MADV_DONTNEED);
+}
+
+int FrameArena::GetNumaNodeCount() {
+  int count = 0;
+  DIR *dir = opendir("/sys/devices/system/node");
+  if (dir == nullptr) {
+    return 1;
+  }
+  while (dirent *entry = readdir(dir)) {
+    if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(entry->d_name[4]) != 0) {
+      count++;
+    }
+  }
+  closedir(dir);
+  return count > 0 ? count : 1;
+}
+
+}  // namespace bustub
@@ -0,0 +1,108 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k) : k_(k), histories_(num_pages) {
+  BUSTUB_ASSERT(k > 0, "LRU-K needs to remember at least one access.");
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+bool LRUKReplacer::Victim(frame_id_t *frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  // Frames with +inf backward K-distance always go first.
+  EvictionQueue *queue = !infinite_queue_.empty() ? &infinite_queue_ : &finite_queue_;
+  if (queue->empty()) {
+    return false;
+  }
+  *frame_id = queue->begin()->second;
+  queue->erase(queue->begin());
+  histories_[*frame_id].evictable_ = false;
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  FrameHistory &history = histories_[frame_id];
+  if (history.evictable_) {
+    Dequeue(frame_id);
+    history.evictable_ = false;
+  }
+  history.accesses_.push_back(current_timestamp_++);
+  if (history.accesses_.size() > k_) {
+    history.accesses_.pop_front();
+  }
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  FrameHistory &history = histories_[frame_id];
+  if (history.evictable_) {
+    return;
+  }
+  if (history.accesses_.empty()) {
+    // A frame that was never pinned has still been used once by whoever unpins it.
+    history.accesses_.push_back(current_timestamp_++);
+  }
+  history.evictable_ = true;
+  Enqueue(frame_id);
+}
+
+void LRUKReplacer::SetEvictable(frame_id_t frame_id, bool evictable) {
+  std::lock_guard<std::mutex> guard(latch_);
+  FrameHistory &history = histories_[frame_id];
+  if (history.evictable_ == evictable) {
+    return;
+  }
+  if (!evictable) {
+    Dequeue(frame_id);
+    history.evictable_ = false;
+    return;
+  }
+  if (history.accesses_.empty()) {
+    history.accesses_.push_back(current_timestamp_++);
+  }
+  history.evictable_ = true;
+  Enqueue(frame_id);
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  FrameHistory &history = histories_[frame_id];
+  if (history.evictable_) {
+    Dequeue(frame_id);
+    history.evictable_ = false;
+  }
+  history.accesses_.clear();
+}
+
+size_t LRUKReplacer::Size() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return infinite_queue_.size() + finite_queue_.size();
+}
+
+void LRUKReplacer::Dequeue(frame_id_t frame_id) {
+  const FrameHistory &history = histories_[frame_id];
+  QueueFor(history)->erase({history.accesses_.front(), frame_id});
+}
+
+void LRUKReplacer::Enqueue(frame_id_t frame_id) {
+  const FrameHistory &history = histories_[frame_id];
+  QueueFor(history)->emplace(history.accesses_.front(), frame_id);
+}
+
+}  // namespace bustub
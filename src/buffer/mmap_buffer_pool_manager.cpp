@@ -0,0 +1,117 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// mmap_buffer_pool_manager.cpp
+//
+// Identification: src/buffer/mmap_buffer_pool_manager.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/mmap_buffer_pool_manager.h"
+
+#include "common/logger.h"
+
+namespace bustub {
+
+MmapBufferPoolManager::MmapBufferPoolManager(DiskManager *disk_manager)
+    : BufferPoolManager(disk_manager, nullptr),
+      num_pages_(disk_manager->GetMappedPageCount()),
+      views_(new std::atomic<Page *>[num_pages_]) {
+  if (!disk_manager->IsMemoryMapped()) {
+    LOG_WARN("the database file is not memory mapped, so the buffer pool has no pages");
+  }
+  // Every mapped page counts as resident; this also sizes the rings of scans, which only serve as prefetch hints here.
+  pool_size_ = num_pages_;
+  max_pool_size_ = num_pages_;
+  for (size_t i = 0; i < num_pages_; ++i) {
+    views_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+MmapBufferPoolManager::~MmapBufferPoolManager() {
+  for (size_t i = 0; i < num_pages_; ++i) {
+    delete views_[i].load(std::memory_order_relaxed);
+  }
+}
+
+BufferPoolStats MmapBufferPoolManager::GetStats() {
+  BufferPoolStats stats;
+  stats_.Collect(&stats);
+  stats.pool_size_ = num_pages_;
+  stats.resident_pages_ = num_views_;
+  return stats;
+}
+
+Page *MmapBufferPoolManager::GetView(page_id_t page_id) {
+  if (page_id < 0 || static_cast<size_t>(page_id) >= num_pages_) {
+    return nullptr;
+  }
+  Page *view = views_[page_id].load(std::memory_order_acquire);
+  if (view != nullptr) {
+    return view;
+  }
+  // Views are created on first use, so that opening a large file costs one pointer per page. If two threads race,
+  // the loser throws its view away. Checksums are verified when the view is created; a corrupt page gets no view and
+  // cannot be fetched.
+  const char *data = disk_manager_->GetMappedPage(page_id);
+  if (!DiskManager::VerifyChecksum(page_id, data)) {
+    LOG_ERROR("checksum mismatch on page %d", page_id);
+    stats_.Add(BufferPoolStatsCollector::CHECKSUM_FAILURES);
+    return nullptr;
+  }
+  auto *new_view = new Page(const_cast<char *>(data));
+  new_view->page_id_ = page_id;
+  if (views_[page_id].compare_exchange_strong(view, new_view, std::memory_order_acq_rel)) {
+    num_views_++;
+    return new_view;
+  }
+  delete new_view;
+  return view;
+}
+
+Page *MmapBufferPoolManager::FetchPageImpl(page_id_t page_id) {
+  Page *page = GetView(page_id);
+  if (page == nullptr) {
+    return nullptr;
+  }
+  page->pin_count_++;
+  stats_.Add(BufferPoolStatsCollector::HITS);
+  return page;
+}
+
+Page *MmapBufferPoolManager::FetchPageWithStrategyImpl(page_id_t page_id, BufferAccessStrategy *strategy) {
+  return FetchPageImpl(page_id);
+}
+
+bool MmapBufferPoolManager::UnpinPageImpl(page_id_t page_id, bool is_dirty) {
+  Page *page = GetView(page_id);
+  if (page == nullptr) {
+    return false;
+  }
+  int pin_count = page->pin_count_.load();
+  while (pin_count > 0 && !page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1)) {
+  }
+  return pin_count > 0;
+}
+
+bool MmapBufferPoolManager::FlushPageImpl(page_id_t page_id) {
+  return page_id >= 0 && static_cast<size_t>(page_id) < num_pages_;
+}
+
+Page *MmapBufferPoolManager::NewPageImpl(page_id_t *page_id) {
+  *page_id = INVALID_PAGE_ID;
+  return nullptr;
+}
+
+Page *MmapBufferPoolManager::NewReservedPageImpl(page_id_t page_id) { return nullptr; }
+
+bool MmapBufferPoolManager::DeletePageImpl(page_id_t page_id) { return false; }
+
+void MmapBufferPoolManager::PrefetchPageImpl(PrefetchRequest request) {
+  disk_manager_->AdviseSequential(request.page_id_, request.chain_length_);
+}
+
+}  // namespace bustub
@@ -0,0 +1,88 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.cpp
+//
+// Identification: src/buffer/page_table.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/page_table.h"
+
+namespace bustub {
+
+PageTable::PageTable(size_t max_entries) : capacity_(16), shift_(60) {
+  // Keeping the load factor at or below one half keeps probe runs short.
+  while (capacity_ < 2 * max_entries) {
+    capacity_ *= 2;
+    shift_--;
+  }
+  slots_ = std::make_unique<std::atomic<uint64_t>[]>(capacity_);
+  for (size_t i = 0; i < capacity_; ++i) {
+    slots_[i].store(EMPTY, std::memory_order_relaxed);
+  }
+}
+
+bool PageTable::Find(page_id_t page_id, frame_id_t *frame_id) const {
+  for (size_t i = HomeSlot(page_id);; i = (i + 1) & (capacity_ - 1)) {
+    uint64_t entry = slots_[i].load(std::memory_order_acquire);
+    if (entry == EMPTY) {
+      return false;
+    }
+    if (KeyOf(entry) == page_id) {
+      *frame_id = FrameOf(entry);
+      return true;
+    }
+  }
+}
+
+size_t PageTable::FindSlot(page_id_t page_id) const {
+  size_t i = HomeSlot(page_id);
+  while (true) {
+    uint64_t entry = slots_[i].load(std::memory_order_relaxed);
+    if (entry == EMPTY || KeyOf(entry) == page_id) {
+      return i;
+    }
+    i = (i + 1) & (capacity_ - 1);
+  }
+}
+
+void PageTable::Insert(page_id_t page_id, frame_id_t frame_id) {
+  size_t i = FindSlot(page_id);
+  if (slots_[i].load(std::memory_order_relaxed) == EMPTY) {
+    BUSTUB_ASSERT(size_ < capacity_ / 2, "The page table holds at most max_entries pages.");
+    size_++;
+  }
+  slots_[i].store(MakeEntry(page_id, frame_id), std::memory_order_release);
+}
+
+bool PageTable::Erase(page_id_t page_id) {
+  size_t hole = FindSlot(page_id);
+  if (slots_[hole].load(std::memory_order_relaxed) == EMPTY) {
+    return false;
+  }
+  // Backward-shift deletion: move later entries of the probe run into the hole if that does not put them before their
+  // home slot, so that no tombstones are needed.
+  for (size_t i = (hole + 1) & (capacity_ - 1);; i = (i + 1) & (capacity_ - 1)) {
+    uint64_t entry = slots_[i].load(std::memory_order_relaxed);
+    if (entry == EMPTY) {
+      break;
+    }
+    size_t home = HomeSlot(KeyOf(entry));
+    // The entry may move iff its home slot is not cyclically within (hole, i].
+    bool home_in_range = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+    if (!home_in_range) {
+      // Copy before clearing, so the entry is visible in at least one slot at any time.
+      slots_[hole].store(entry, std::memory_order_release);
+      hole = i;
+    }
+  }
+  slots_[hole].store(EMPTY, std::memory_order_release);
+  size_--;
+  return true;
+}
+
+}  // namespace bustub
@@ -0,0 +1,156 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// parallel_buffer_pool_manager.cpp
+//
+// Identification: src/buffer/parallel_buffer_pool_manager.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/parallel_buffer_pool_manager.h"
+
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+namespace bustub {
+
+ParallelBufferPoolManager::ParallelBufferPoolManager(size_t num_instances, size_t pool_size,
+                                                     DiskManager *disk_manager, LogManager *log_manager,
+                                                     ReplacerType replacer_type)
+    : BufferPoolManager(disk_manager, log_manager) {
+  BUSTUB_ASSERT(num_instances > 0, "A parallel buffer pool needs at least one shard.");
+  pool_size_ = num_instances * pool_size;
+  instances_.reserve(num_instances);
+  for (size_t i = 0; i < num_instances; ++i) {
+    instances_.push_back(new BufferPoolManager(pool_size, static_cast<uint32_t>(num_instances),
+                                               static_cast<uint32_t>(i), disk_manager, log_manager, replacer_type));
+    max_pool_size_ += instances_.back()->GetMaxPoolSize();
+  }
+}
+
+ParallelBufferPoolManager::~ParallelBufferPoolManager() {
+  // The statistics dump reads every shard.
+  StopStatsDump();
+  // Stop every shard's I/O thread first, since they forward prefetches of chained pages to each other.
+  for (auto *instance : instances_) {
+    instance->StopPrefetchThread();
+  }
+  for (auto *instance : instances_) {
+    delete instance;
+  }
+}
+
+BufferPoolManager *ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) {
+  return instances_[static_cast<size_t>(page_id) % instances_.size()];
+}
+
+Page *ParallelBufferPoolManager::FetchPageImpl(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return nullptr;
+  }
+  return GetBufferPoolManager(page_id)->FetchPage(page_id);
+}
+
+Page *ParallelBufferPoolManager::FetchPageWithStrategyImpl(page_id_t page_id, BufferAccessStrategy *strategy) {
+  if (page_id == INVALID_PAGE_ID) {
+    return nullptr;
+  }
+  return GetBufferPoolManager(page_id)->FetchPageWithStrategy(page_id, strategy);
+}
+
+bool ParallelBufferPoolManager::UnpinPageImpl(page_id_t page_id, bool is_dirty) {
+  if (page_id == INVALID_PAGE_ID) {
+    return false;
+  }
+  return GetBufferPoolManager(page_id)->UnpinPage(page_id, is_dirty);
+}
+
+bool ParallelBufferPoolManager::FlushPageImpl(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return false;
+  }
+  return GetBufferPoolManager(page_id)->FlushPage(page_id);
+}
+
+Page *ParallelBufferPoolManager::NewPageImpl(page_id_t *page_id) {
+  size_t num_instances = instances_.size();
+  size_t start = next_instance_.fetch_add(1) % num_instances;
+  for (size_t i = 0; i < num_instances; ++i) {
+    Page *page = instances_[(start + i) % num_instances]->NewPage(page_id);
+    if (page != nullptr) {
+      return page;
+    }
+  }
+  *page_id = INVALID_PAGE_ID;
+  return nullptr;
+}
+
+Page *ParallelBufferPoolManager::NewReservedPageImpl(page_id_t page_id) {
+  return GetBufferPoolManager(page_id)->NewReservedPageImpl(page_id);
+}
+
+bool ParallelBufferPoolManager::DeletePageImpl(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return true;
+  }
+  return GetBufferPoolManager(page_id)->DeletePage(page_id);
+}
+
+void ParallelBufferPoolManager::FlushAllPagesImpl() {
+  // Consecutive page ids live in different shards, so the dirty pages of all shards are written together.
+  std::vector<DirtyPage> pages;
+  for (auto *instance : instances_) {
+    instance->HoldDirtyPages(&pages);
+  }
+  WriteDirtyPages(&pages);
+}
+
+bool ParallelBufferPoolManager::Resize(size_t new_size) {
+  size_t num_instances = instances_.size();
+  if (new_size < num_instances || new_size > max_pool_size_) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(resize_latch_);
+  for (size_t i = 0; i < num_instances; ++i) {
+    // The first new_size % num_instances shards get one frame more than the rest.
+    size_t shard_size = new_size / num_instances + (i < new_size % num_instances ? 1 : 0);
+    if (!instances_[i]->Resize(shard_size)) {
+      UNREACHABLE("every shard can grow as far as its share of max_pool_size_");
+    }
+  }
+  pool_size_ = new_size;
+  return true;
+}
+
+BufferPoolStats ParallelBufferPoolManager::GetStats() {
+  BufferPoolStats stats;
+  for (auto *instance : instances_) {
+    stats.Merge(instance->GetStats());
+  }
+  return stats;
+}
+
+void ParallelBufferPoolManager::StartBackgroundWriter(double target_clean_fraction) {
+  for (auto *instance : instances_) {
+    instance->StartBackgroundWriter(target_clean_fraction);
+  }
+}
+
+void ParallelBufferPoolManager::StopBackgroundWriter() {
+  for (auto *instance : instances_) {
+    instance->StopBackgroundWriter();
+  }
+}
+
+void ParallelBufferPoolManager::PrefetchPageImpl(PrefetchRequest request) {
+  if (request.page_id_ == INVALID_PAGE_ID) {
+    return;
+  }
+  GetBufferPoolManager(request.page_id_)->PrefetchPageImpl(std::move(request));
+}
+
+}  // namespace bustub
@@ -0,0 +1,160 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.cpp
+//
+// Identification: src/common/util/crc32c.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <array>
+#include <cstring>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#include "common/util/crc32c.h"
+
+namespace bustub {
+
+#if defined(__SSE4_2__)
+
+static inline uint32_t Crc32cByte(uint32_t crc, uint8_t byte) { return _mm_crc32_u8(crc, byte); }
+static inline uint32_t Crc32cWord(uint32_t crc, uint64_t word) {
+  return static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+}
+
+#elif defined(__ARM_FEATURE_CRC32)
+
+static inline uint32_t Crc32cByte(uint32_t crc, uint8_t byte) { return __crc32cb(crc, byte); }
+static inline uint32_t Crc32cWord(uint32_t crc, uint64_t word) { return __crc32cd(crc, word); }
+
+#else
+
+/** Reflected CRC-32C polynomial. */
+static constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78;
+
+/** table[k][b] is the CRC of byte b followed by k zero bytes, for slicing by eight. */
+static const std::array<std::array<uint32_t, 256>, 8> &Crc32cTable() {
+  static const auto table = [] {
+    std::array<std::array<uint32_t, 256>, 8> t{};
+    for (uint32_t b = 0; b < 256; ++b) {
+      uint32_t crc = b;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ ((crc & 1) != 0 ? CRC32C_POLYNOMIAL : 0);
+      }
+      t[0][b] = crc;
+    }
+    for (uint32_t b = 0; b < 256; ++b) {
+      for (size_t k = 1; k < 8; ++k) {
+        t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+      }
+    }
+    return t;
+  }();
+  return table;
+}
+
+static inline uint32_t Crc32cByte(uint32_t crc, uint8_t byte) {
+  return (crc >> 8) ^ Crc32cTable()[0][(crc ^ byte) & 0xFF];
+}
+
+static inline uint32_t Crc32cWord(uint32_t crc, uint64_t word) {
+  const auto &t = Crc32cTable();
+  word ^= crc;
+  return t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF] ^ t[4][(word >> 24) & 0xFF] ^
+         t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^ t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+}
+
+#endif
+
+/** Length of each of the three streams that Extend checksums side by side; three of them nearly fill a page. */
+static constexpr size_t STREAM_BYTES = 1344;
+
+/**
+ * Multiplies two polynomials modulo the CRC-32C polynomial, in the reflected bit order of the checksums (the top bit
+ * is x^0).
+ */
+static uint32_t MultiplyModP(uint32_t a, uint32_t b) {
+  constexpr uint32_t polynomial = 0x82F63B78;
+  uint32_t product = 0;
+  for (uint32_t m = 1U << 31; m != 0; m >>= 1) {
+    if ((a & m) != 0) {
+      product ^= b;
+    }
+    b = (b & 1) != 0 ? (b >> 1) ^ polynomial : b >> 1;
+  }
+  return product;
+}
+
+/** @return x^(8 * bytes) modulo the CRC-32C polynomial, which shifts a checksum past that many bytes */
+static uint32_t ShiftOperator(size_t bytes) {
+  uint32_t result = 1U << 31;
+  uint32_t power = 1U << 30;
+  for (size_t bits = 8 * bytes; bits != 0; bits >>= 1) {
+    if ((bits & 1) != 0) {
+      result = MultiplyModP(result, power);
+    }
+    power = MultiplyModP(power, power);
+  }
+  return result;
+}
+
+static inline uint64_t LoadWord(const uint8_t *bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof(word));
+  return word;
+}
+
+uint32_t Crc32c::Extend(uint32_t crc, const char *data, size_t length) {
+  static const uint32_t shift_one = ShiftOperator(STREAM_BYTES);
+  static const uint32_t shift_two = ShiftOperator(2 * STREAM_BYTES);
+  auto *bytes = reinterpret_cast<const uint8_t *>(data);
+  crc = ~crc;
+  // Head bytes up to an 8-byte boundary, then whole words (little-endian loads), then the tail.
+  while (length > 0 && reinterpret_cast<uintptr_t>(bytes) % sizeof(uint64_t) != 0) {
+    crc = Crc32cByte(crc, *bytes++);
+    --length;
+  }
+  // Each crc32 instruction depends on the one before, so a single stream runs at the instruction's latency. Three
+  // independent streams over consecutive blocks keep the unit busy; their checksums are then combined with
+  // crc(A B C) = crc(A) * x^(8|B C|) + crc(B) * x^(8|C|) + crc(C).
+  while (length >= 3 * STREAM_BYTES) {
+    uint32_t crc_b = ~0U;
+    uint32_t crc_c = ~0U;
+    for (size_t i = 0; i < STREAM_BYTES; i += sizeof(uint64_t)) {
+      crc = Crc32cWord(crc, LoadWord(bytes + i));
+      crc_b = Crc32cWord(crc_b, LoadWord(bytes + STREAM_BYTES + i));
+      crc_c = Crc32cWord(crc_c, LoadWord(bytes + 2 * STREAM_BYTES + i));
+    }
+    crc = ~(MultiplyModP(shift_two, ~crc) ^ MultiplyModP(shift_one, ~crc_b) ^ ~crc_c);
+    bytes += 3 * STREAM_BYTES;
+    length -= 3 * STREAM_BYTES;
+  }
+  while (length >= sizeof(uint64_t)) {
+    crc = Crc32cWord(crc, LoadWord(bytes));
+    bytes += sizeof(uint64_t);
+    length -= sizeof(uint64_t);
+  }
+  while (length > 0) {
+    crc = Crc32cByte(crc, *bytes++);
+    --length;
+  }
+  return ~crc;
+}
+
+bool Crc32c::IsHardwareAccelerated() {
+#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace bustub
@@ -0,0 +1,215 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_codec.cpp
+//
+// Identification: src/common/util/lz4_codec.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "common/util/lz4_codec.h"
+
+namespace bustub {
+
+static constexpr size_t MIN_MATCH = 4;
+/** The format requires the last five bytes to be literals and the last match to start twelve bytes before the end. */
+static constexpr size_t LAST_LITERALS = 5;
+static constexpr size_t MATCH_FIND_LIMIT = 12;
+static constexpr size_t MAX_OFFSET = 65535;
+static constexpr int HASH_BITS = 12;
+/** After this many misses in a row, the compressor starts skipping ahead faster through incompressible data. */
+static constexpr int SKIP_TRIGGER = 6;
+static constexpr size_t FAST_COPY = 16;
+
+static inline uint32_t Load32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint64_t Load64(const uint8_t *p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint32_t Hash(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - HASH_BITS); }
+
+/** Appends a length that did not fit into its four token bits as a run of 255s and a final byte. */
+static inline bool PutLength(size_t length, uint8_t *out, size_t *op, size_t capacity) {
+  for (; length >= 255; length -= 255) {
+    if (*op >= capacity) {
+      return false;
+    }
+    out[(*op)++] = 255;
+  }
+  if (*op >= capacity) {
+    return false;
+  }
+  out[(*op)++] = static_cast<uint8_t>(length);
+  return true;
+}
+
+/** Appends one sequence: a literal run followed by a match, or just the literals if match_length is 0. */
+static bool PutSequence(const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length,
+                        uint8_t *out, size_t *op, size_t capacity) {
+  if (*op >= capacity) {
+    return false;
+  }
+  size_t token_op = (*op)++;
+  auto token = static_cast<uint8_t>(std::min<size_t>(literal_length, 15) << 4);
+  if (literal_length >= 15 && !PutLength(literal_length - 15, out, op, capacity)) {
+    return false;
+  }
+  if (capacity - *op < literal_length) {
+    return false;
+  }
+  memcpy(out + *op, literals, literal_length);
+  *op += literal_length;
+  if (match_length > 0) {
+    if (capacity - *op < 2) {
+      return false;
+    }
+    out[(*op)++] = static_cast<uint8_t>(offset & 0xFF);
+    out[(*op)++] = static_cast<uint8_t>(offset >> 8);
+    size_t extra = match_length - MIN_MATCH;
+    token |= static_cast<uint8_t>(std::min<size_t>(extra, 15));
+    if (extra >= 15 && !PutLength(extra - 15, out, op, capacity)) {
+      return false;
+    }
+  }
+  out[token_op] = token;
+  return true;
+}
+
+/** Reads the continuation bytes of a length whose token bits were all set. */
+static inline bool GetLength(const uint8_t *in, size_t length, size_t *ip, size_t *value) {
+  uint8_t byte;
+  do {
+    if (*ip >= length) {
+      return false;
+    }
+    byte = in[(*ip)++];
+    *value += byte;
+  } while (byte == 255);
+  return true;
+}
+
+size_t Lz4Codec::Compress(const char *src, size_t length, char *dst, size_t capacity) {
+  auto *in = reinterpret_cast<const uint8_t *>(src);
+  auto *out = reinterpret_cast<uint8_t *>(dst);
+  size_t op = 0;
+  size_t anchor = 0;
+  if (length > MATCH_FIND_LIMIT) {
+    // Positions are stored plus one, so that zero marks an empty entry.
+    std::array<uint32_t, 1 << HASH_BITS> table{};
+    size_t match_start_limit = length - MATCH_FIND_LIMIT;
+    size_t match_end_limit = length - LAST_LITERALS;
+    size_t ip = 0;
+    int misses = 0;
+    while (ip < match_start_limit) {
+      uint32_t sequence = Load32(in + ip);
+      uint32_t &entry = table[Hash(sequence)];
+      size_t candidate = entry;
+      entry = static_cast<uint32_t>(ip + 1);
+      if (candidate == 0 || ip - (candidate - 1) > MAX_OFFSET || Load32(in + candidate - 1) != sequence) {
+        ip += 1 + (misses++ >> SKIP_TRIGGER);
+        continue;
+      }
+      candidate--;
+      // Extend the match eight bytes at a time; the first differing byte is the lowest set bit of the difference.
+      size_t match_length = MIN_MATCH;
+      while (ip + match_length + sizeof(uint64_t) <= match_end_limit) {
+        uint64_t difference = Load64(in + ip + match_length) ^ Load64(in + candidate + match_length);
+        if (difference != 0) {
+          match_length += __builtin_ctzll(difference) / 8;
+          break;
+        }
+        match_length += sizeof(uint64_t);
+      }
+      if (ip + match_length + sizeof(uint64_t) > match_end_limit) {
+        while (ip + match_length < match_end_limit && in[candidate + match_length] == in[ip + match_length]) {
+          match_length++;
+        }
+      }
+      if (!PutSequence(in + anchor, ip - anchor, ip - candidate, match_length, out, &op, capacity)) {
+        return 0;
+      }
+      ip += match_length;
+      anchor = ip;
+      misses = 0;
+    }
+  }
+  if (!PutSequence(in + anchor, length - anchor, 0, 0, out, &op, capacity)) {
+    return 0;
+  }
+  return op;
+}
+
+bool Lz4Codec::Decompress(const char *src, size_t length, char *dst, size_t decompressed_length) {
+  auto *in = reinterpret_cast<const uint8_t *>(src);
+  auto *out = reinterpret_cast<uint8_t *>(dst);
+  size_t ip = 0;
+  size_t op = 0;
+  while (ip < length) {
+    uint8_t token = in[ip++];
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !GetLength(in, length, &ip, &literal_length)) {
+      return false;
+    }
+    if (length - ip < literal_length || decompressed_length - op < literal_length) {
+      return false;
+    }
+    // Short runs are copied with a fixed-size copy, which compiles to two moves, where both buffers have the room.
+    if (literal_length <= FAST_COPY && length - ip >= FAST_COPY && decompressed_length - op >= FAST_COPY) {
+      memcpy(out + op, in + ip, FAST_COPY);
+    } else {
+      memcpy(out + op, in + ip, literal_length);
+    }
+    ip += literal_length;
+    op += literal_length;
+    if (ip == length) {
+      // The last sequence has no match.
+      break;
+    }
+
+    if (length - ip < 2) {
+      return false;
+    }
+    size_t offset = in[ip] | (static_cast<size_t>(in[ip + 1]) << 8);
+    ip += 2;
+    size_t match_length = (token & 15) + MIN_MATCH;
+    if ((token & 15) == 15 && !GetLength(in, length, &ip, &match_length)) {
+      return false;
+    }
+    if (offset == 0 || offset > op || decompressed_length - op < match_length) {
+      return false;
+    }
+    // A match may overlap the bytes it produces (offset < length encodes a repetition with period offset). The bytes
+    // from the match to the output are periodic, so each copy may be as long as everything copied before it.
+    const uint8_t *match = out + op - offset;
+    uint8_t *copy = out + op;
+    if (match_length <= FAST_COPY && offset >= FAST_COPY && decompressed_length - op >= FAST_COPY) {
+      memcpy(copy, match, FAST_COPY);
+      op += match_length;
+      continue;
+    }
+    for (size_t left = match_length; left > 0;) {
+      size_t count = std::min<size_t>(left, copy - match);
+      memcpy(copy, match, count);
+      copy += count;
+      left -= count;
+    }
+    op += match_length;
+  }
+  return op == decompressed_length;
+}
+
+}  // namespace bustub
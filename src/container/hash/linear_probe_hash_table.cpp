@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -26,133 +27,116 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::LinearProbeHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
                                       const KeyComparator &comparator, size_t num_buckets,
                                       HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
-      auto header_page = reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->NewPage(&header_page_id_, nullptr)->GetData());
-      num_buckets_ = num_buckets;
-      header_page->SetSize(buffer_pool_manager->GetPoolSize());
-      for( size_t i=0; i< buffer_pool_manager->GetPoolSize(); i++){
-        page_id_t block_page_id;
-        buffer_pool_manager->NewPage(&block_page_id, nullptr);
-        header_page->AddBlockPageId(block_page_id);
-      }
-
-    }
+    : buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)),
+      num_buckets_(num_buckets),
+      block_size_(BlockSizeFor(num_buckets)) {
+  BUSTUB_ASSERT(num_buckets > 0, "The hash table needs at least one bucket.");
+  BUSTUB_ASSERT(NumBlocksFor(num_buckets) <= HashTableHeaderPage::MAX_NUM_BLOCKS,
+                "The header page cannot list a block for every bucket.");
+  if (!CreateTablePages(num_buckets, &header_page_id_, &block_page_ids_)) {
+    throw Exception("can't create the pages of the hash table");
+  }
+}
 
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) {
-  auto header_page = reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id_, nullptr)->GetData());
-  auto hash_key = hash_fn_.GetHash(key);
-  auto header_index = (hash_key%num_buckets_)/(num_buckets_/buffer_pool_manager_->GetPoolSize());
-  auto first_header = header_index;
-  auto block_index = (hash_key%num_buckets_)%(num_buckets_/buffer_pool_manager_->GetPoolSize());
-  auto first_block = block_index;
-  // std::cout<<"--"<<"key():"<<key<<"--"<<"hash_key:"<<hash_key<<"--"<<"header_index:"<<header_index<<"--"<<"block_index:"<<block_index<<"--"<<std::endl;
-  page_id_t block_page_id = header_page->GetBlockPageId(header_index);
-  auto block_page = reinterpret_cast<HashTableBlockPage<KeyType, ValueType, KeyComparator> *>(buffer_pool_manager_->FetchPage(block_page_id, nullptr)->GetData());
-  if(!block_page->IsOccupied(block_index)){
-    return false;
-  }
-  if(block_page->IsReadable(block_index) && !comparator_(block_page->KeyAt(block_index), key)){
-    // std::cout<<"---"<<"ValueAt()"<<"---"<<block_page->ValueAt(block_index);
-    // table_latch_.RLock();
-    result->push_back(block_page->ValueAt(block_index));
-    // table_latch_.RUnlock();
-  }
-  if(block_index < num_buckets_/buffer_pool_manager_->GetPoolSize()-1){
-    block_index++;
-  }
-  else{
-    header_index = (header_index+1)%buffer_pool_manager_->GetPoolSize();
-    block_index = 0;
-  }
-  while(!(first_header == header_index and first_block == block_index)){
-    // std::cout<<block_index;
-    // std::cout<<comparator_(block_page->KeyAt(block_index), 
-    page_id_t block_page_id = header_page->GetBlockPageId(header_index);
-    auto block_page = reinterpret_cast<HashTableBlockPage<KeyType, ValueType, KeyComparator> *>(buffer_pool_manager_->FetchPage(block_page_id, nullptr)->GetData());
-    if(!block_page->IsOccupied(block_index)){
-      break;
-    }
-    if(block_page->IsReadable(block_index) && !comparator_(block_page->KeyAt(block_index), key)){
-      // std::cout<<"---"<<"ValueAt()"<<"---"<<block_page->ValueAt(block_index);
-      // table_latch_.RLock();
-      result->push_back(block_page->ValueAt(block_index));
-      // table_latch_.RUnlock();
-    }
-    if(block_index < num_buckets_/buffer_pool_manager_->GetPoolSize()-1){
-      block_index++;
+  table_latch_.RLock();
+  size_t num_slots = block_size_ * block_page_ids_.size();
+  size_t slot = hash_fn_.GetHash(key) % num_slots;
+
+  // Probe from the key's slot until an empty slot, one block at a time. The slots of a block are read in a single
+  // optimistic read, so lookups do not latch the blocks, and only the readable slots of the run are compared.
+  for (size_t left = num_slots; left > 0;) {
+    size_t block_index = slot % block_size_;
+    size_t end = std::min(block_size_, block_index + left);
+    BasicPageGuard block_guard = buffer_pool_manager_->FetchPageBasic(block_page_ids_[slot / block_size_]);
+    if (!block_guard.IsValid()) {
+      // The block could not be fetched, so the lookup cannot tell whether the key has more values.
+      table_latch_.RUnlock();
+      return false;
     }
-    else{
-      header_index = (header_index+1)%buffer_pool_manager_->GetPoolSize();
-      block_index = 0;
+    auto block_page = block_guard.As<BlockPage>();
+    auto [chain_ends, matches] = block_guard.GetPage()->OptimisticRead([&] {
+      std::vector<ValueType> block_matches;
+      slot_offset_t run_end = block_page->NextUnoccupied(block_index, end);
+      for (slot_offset_t i = block_page->NextReadable(block_index, run_end); i < run_end;
+           i = block_page->NextReadable(i + 1, run_end)) {
+        if (comparator_(block_page->KeyAt(i), key) == 0) {
+          block_matches.push_back(block_page->ValueAt(i));
+        }
+      }
+      return std::make_pair(run_end < end, std::move(block_matches));
+    });
+    result->insert(result->end(), matches.begin(), matches.end());
+    if (chain_ends) {
+      break;
     }
+    left -= end - block_index;
+    slot = (slot + end - block_index) % num_slots;
   }
-  return true;
+  table_latch_.RUnlock();
+  return !result->empty();
 }
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  auto header_page = reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id_, nullptr)->GetData());
-  auto hash_key = hash_fn_.GetHash(key);
-  auto header_index = (hash_key%num_buckets_)/(num_buckets_/buffer_pool_manager_->GetPoolSize());
-  auto first_header = header_index;
-  auto block_index = (hash_key%num_buckets_)%(num_buckets_/buffer_pool_manager_->GetPoolSize());
-  auto first_block = block_index;
-  // std::cout<<"--"<<"key():"<<key<<"--"<<"hash_key:"<<hash_key<<"--"<<"header_index:"<<header_index<<"--"<<"block_index:"<<block_index<<"--"<<std::endl;
-  page_id_t block_page_id = header_page->GetBlockPageId(header_index);
-  auto block_page = reinterpret_cast<HashTableBlockPage<KeyType, ValueType, KeyComparator> *>(buffer_pool_manager_->FetchPage(block_page_id, nullptr)->GetData());
-  if(!block_page->IsOccupied(block_index)){
-    // table_latch_.WLock();
-    // table_latch_.RLock();
-    bool  B = block_page->Insert(block_index, key, value);
-    // table_latch_.RUnlock();
-    // table_latch_.WUnlock();
-  return B;
-  }
-  if(block_page->IsReadable(block_index) && !comparator_(block_page->KeyAt(block_index), key) && block_page->ValueAt(block_index)==value){
-    return false;
-  }
-  if(block_index < num_buckets_/buffer_pool_manager_->GetPoolSize()-1){
-    block_index++;
-  }
-  else{
-    header_index = (header_index+1)%buffer_pool_manager_->GetPoolSize();
-    block_index = 0;
-  }
-  while(!(first_header == header_index and first_block == block_index)){
-    page_id_t block_page_id = header_page->GetBlockPageId(header_index);
-    auto block_page = reinterpret_cast<HashTableBlockPage<KeyType, ValueType, KeyComparator> *>(buffer_pool_manager_->FetchPage(block_page_id, nullptr)->GetData());
-    if(!block_page->IsOccupied(block_index)){
-      break;
+  while (true) {
+    bool inserted;
+    table_latch_.RLock();
+    size_t num_buckets = num_buckets_;
+    bool has_room = InsertIntoTable(block_page_ids_, block_size_, key, value, &inserted);
+    table_latch_.RUnlock();
+    if (has_room) {
+      return inserted;
     }
-    if(block_page->IsReadable(block_index) && !comparator_(block_page->KeyAt(block_index), key) && block_page->ValueAt(block_index)==value){
+    // Every slot is occupied. Resize takes the table latch in write mode, and does nothing if another thread has grown
+    // the table since we looked at it. If the table did not grow at all, Resize could not create its pages.
+    Resize(num_buckets);
+    if (GetSize() <= num_buckets) {
       return false;
     }
-    if(block_index < num_buckets_/buffer_pool_manager_->GetPoolSize()-1){
-      block_index++;
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::InsertIntoTable(const std::vector<page_id_t> &block_page_ids, size_t block_size,
+                                      const KeyType &key, const ValueType &value, bool *inserted) {
+  size_t num_slots = block_size * block_page_ids.size();
+  size_t slot = hash_fn_.GetHash(key) % num_slots;
+
+  // Probe until an empty slot, rejecting the pair if it is already in the table.
+  for (size_t left = num_slots; left > 0;) {
+    size_t block_index = slot % block_size;
+    size_t end = std::min(block_size, block_index + left);
+    WritePageGuard block_guard = buffer_pool_manager_->FetchPageWrite(block_page_ids[slot / block_size]);
+    if (!block_guard.IsValid()) {
+      *inserted = false;
+      return true;
     }
-    else{
-      header_index = (header_index+1)%buffer_pool_manager_->GetPoolSize();
-      block_index = 0;
+    auto block_page = block_guard.As<BlockPage>();
+    slot_offset_t run_end = block_page->NextUnoccupied(block_index, end);
+    for (slot_offset_t i = block_page->NextReadable(block_index, run_end); i < run_end;
+         i = block_page->NextReadable(i + 1, run_end)) {
+      if (comparator_(block_page->KeyAt(i), key) == 0 && block_page->ValueAt(i) == value) {
+        *inserted = false;
+        return true;
+      }
     }
-    
-  }
-  if(first_header == header_index and first_block == block_index){
-    Resize(num_buckets_);
-    return Insert(transaction, key, value);
+    if (run_end < end) {
+      *inserted = block_guard.AsMut<BlockPage>()->Insert(run_end, key, value);
+      return true;
+    }
+    left -= end - block_index;
+    slot = (slot + end - block_index) % num_slots;
   }
-  // std::cout<<"--"<<"insert()"<<"--"<<"("<<header_index<<","<<block_index<<","<<key<<","<<value<<")"<<std::endl;
-  // table_latch_.WLock();
-  // table_latch_.RLock();
-  bool  B = block_page->Insert(block_index, key, value);
-  // table_latch_.RUnlock();
-  // table_latch_.WUnlock();
-  return B;
+  return false;
 }
 
 /*****************************************************************************
@@ -160,55 +144,36 @@ bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  auto header_page = reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id_, nullptr)->GetData());
-  auto hash_key = hash_fn_.GetHash(key);
-  auto header_index = (hash_key%num_buckets_)/(num_buckets_/buffer_pool_manager_->GetPoolSize());
-  auto first_header = header_index;
-  auto block_index = (hash_key%num_buckets_)%(num_buckets_/buffer_pool_manager_->GetPoolSize());
-  auto first_block = block_index;
-  // std::cout<<"--"<<"key():"<<key<<"--"<<"hash_key:"<<hash_key<<"--"<<"header_index:"<<header_index<<"--"<<"block_index:"<<block_index<<"--"<<std::endl;
-  page_id_t block_page_id = header_page->GetBlockPageId(header_index);
-  auto block_page = reinterpret_cast<HashTableBlockPage<KeyType, ValueType, KeyComparator> *>(buffer_pool_manager_->FetchPage(block_page_id, nullptr)->GetData());
-  if(block_page->IsOccupied(block_index)){
-    if(block_page->IsReadable(block_index) && !comparator_(block_page->KeyAt(block_index), key) && block_page->ValueAt(block_index)==value){
-      // table_latch_.WLock();
-      // table_latch_.RLock();
-      block_page->Remove(block_index);
-      // table_latch_.RUnlock();
-      // table_latch_.WUnlock();
-      return true;
-    }
-    if(block_index < num_buckets_/buffer_pool_manager_->GetPoolSize()-1){
-      block_index++;
-    }
-    else{
-      header_index = (header_index+1)%buffer_pool_manager_->GetPoolSize();
-      block_index = 0;
-    }
-  }
-  while(!(first_header == header_index and first_block == block_index)){
-    page_id_t block_page_id = header_page->GetBlockPageId(header_index);
-    auto block_page = reinterpret_cast<HashTableBlockPage<KeyType, ValueType, KeyComparator> *>(buffer_pool_manager_->FetchPage(block_page_id, nullptr)->GetData());
-    if(!block_page->IsOccupied(block_index)){
+  bool removed = false;
+  table_latch_.RLock();
+  size_t num_slots = block_size_ * block_page_ids_.size();
+  size_t slot = hash_fn_.GetHash(key) % num_slots;
+
+  for (size_t left = num_slots; left > 0 && !removed;) {
+    size_t block_index = slot % block_size_;
+    size_t end = std::min(block_size_, block_index + left);
+    WritePageGuard block_guard = buffer_pool_manager_->FetchPageWrite(block_page_ids_[slot / block_size_]);
+    if (!block_guard.IsValid()) {
       break;
     }
-    if(block_page->IsReadable(block_index) && !comparator_(block_page->KeyAt(block_index), key) && block_page->ValueAt(block_index)==value){
-      // table_latch_.WLock();
-      // table_latch_.RLock();
-      block_page->Remove(block_index);
-      // table_latch_.RUnlock();
-      // table_latch_.WUnlock();
-      return true;
-    }
-    if(block_index < num_buckets_/buffer_pool_manager_->GetPoolSize()-1){
-      block_index++;
+    auto block_page = block_guard.As<BlockPage>();
+    slot_offset_t run_end = block_page->NextUnoccupied(block_index, end);
+    for (slot_offset_t i = block_page->NextReadable(block_index, run_end); i < run_end;
+         i = block_page->NextReadable(i + 1, run_end)) {
+      if (comparator_(block_page->KeyAt(i), key) == 0 && block_page->ValueAt(i) == value) {
+        block_guard.AsMut<BlockPage>()->Remove(i);
+        removed = true;
+        break;
+      }
     }
-    else{
-      header_index = (header_index+1)%buffer_pool_manager_->GetPoolSize();
-      block_index = 0;
+    if (run_end < end) {
+      break;
     }
+    left -= end - block_index;
+    slot = (slot + end - block_index) % num_slots;
   }
-  return false;
+  table_latch_.RUnlock();
+  return removed;
 }
 
 /*****************************************************************************
@@ -216,22 +181,86 @@ bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::Resize(size_t initial_size) {
-  auto header_page = reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id_, nullptr)->GetData());
-  page_id_t new_page_id;
-  auto new_header_page = reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->NewPage(&new_page_id, nullptr)->GetData());
-  new_header_page->SetSize(2*initial_size);
-  for(size_t i = 0; i<buffer_pool_manager_->GetPoolSize(); i+=2){
-    auto block_id_1 = header_page->GetBlockPageId(i);
-    auto block_id_2 = header_page->GetBlockPageId(i+1);
-    auto block1 = reinterpret_cast<HashTableBlockPage<KeyType, ValueType, KeyComparator> *>(buffer_pool_manager_->FetchPage(block_id_1, nullptr)->GetData());
-    auto block2 = reinterpret_cast<HashTableBlockPage<KeyType, ValueType, KeyComparator> *>(buffer_pool_manager_->FetchPage(block_id_2, nullptr)->GetData());
-    for(size_t j =0; j<num_buckets_/buffer_pool_manager_->GetPoolSize(); j++){
-      block1->Insert(num_buckets_/buffer_pool_manager_->GetPoolSize()+j, block2->KeyAt(j), block2->ValueAt(j));
+  table_latch_.WLock();
+  size_t new_num_buckets = 2 * initial_size;
+  if (num_buckets_ >= new_num_buckets) {
+    // Another thread has already grown the table.
+    table_latch_.WUnlock();
+    return;
+  }
+  BUSTUB_ASSERT(NumBlocksFor(new_num_buckets) <= HashTableHeaderPage::MAX_NUM_BLOCKS,
+                "The header page cannot list a block for every bucket.");
+
+  // Build the new table next to the old one, and rehash the readable pairs of the old blocks into it. Tombstones are
+  // dropped on the way. No other operation runs while we hold the table latch in write mode. If a page cannot be
+  // created or fetched, the new table is dropped and the old one stays as it is.
+  page_id_t new_header_page_id;
+  std::vector<page_id_t> new_block_page_ids;
+  size_t new_block_size = BlockSizeFor(new_num_buckets);
+  bool rehashed = CreateTablePages(new_num_buckets, &new_header_page_id, &new_block_page_ids);
+  for (size_t b = 0; rehashed && b < block_page_ids_.size(); b++) {
+    ReadPageGuard block_guard = buffer_pool_manager_->FetchPageRead(block_page_ids_[b]);
+    if (!block_guard.IsValid()) {
+      rehashed = false;
+      break;
     }
-    new_header_page->AddBlockPageId(block_id_1);
+    auto block_page = block_guard.As<BlockPage>();
+    for (slot_offset_t i = block_page->NextReadable(0, block_size_); rehashed && i < block_size_;
+         i = block_page->NextReadable(i + 1, block_size_)) {
+      // The pairs of the old table are distinct, so a pair that is not inserted hit a block that could not be fetched.
+      bool inserted;
+      rehashed = InsertIntoTable(new_block_page_ids, new_block_size, block_page->KeyAt(i), block_page->ValueAt(i),
+                                 &inserted) &&
+                 inserted;
+    }
+  }
+  if (!rehashed) {
+    DeleteTablePages(new_header_page_id, new_block_page_ids);
+    table_latch_.WUnlock();
+    return;
+  }
+  DeleteTablePages(header_page_id_, block_page_ids_);
+  header_page_id_ = new_header_page_id;
+  num_buckets_ = new_num_buckets;
+  block_page_ids_ = std::move(new_block_page_ids);
+  block_size_ = new_block_size;
+  table_latch_.WUnlock();
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::CreateTablePages(size_t num_buckets, page_id_t *header_page_id,
+                                       std::vector<page_id_t> *block_page_ids) {
+  BasicPageGuard header_guard = buffer_pool_manager_->NewPageGuarded(header_page_id);
+  if (!header_guard.IsValid()) {
+    *header_page_id = INVALID_PAGE_ID;
+    return false;
+  }
+  auto header_page = header_guard.AsMut<HashTableHeaderPage>();
+  header_page->SetSize(num_buckets);
+  for (size_t i = 0; i < NumBlocksFor(num_buckets); i++) {
+    // A zeroed page is an empty block, so the new block can be unpinned right away.
+    page_id_t block_page_id;
+    if (!buffer_pool_manager_->NewPageGuarded(&block_page_id).IsValid()) {
+      header_guard.Drop();
+      DeleteTablePages(*header_page_id, *block_page_ids);
+      block_page_ids->clear();
+      *header_page_id = INVALID_PAGE_ID;
+      return false;
+    }
+    header_page->AddBlockPageId(block_page_id);
+    block_page_ids->push_back(block_page_id);
+  }
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::DeleteTablePages(page_id_t header_page_id, const std::vector<page_id_t> &block_page_ids) {
+  for (page_id_t block_page_id : block_page_ids) {
+    buffer_pool_manager_->DeletePage(block_page_id);
+  }
+  if (header_page_id != INVALID_PAGE_ID) {
+    buffer_pool_manager_->DeletePage(header_page_id);
   }
-  num_buckets_ = 2*initial_size;
-  header_page_id_ = new_page_id;
 }
 
 /*****************************************************************************
@@ -239,8 +268,10 @@ void HASH_TABLE_TYPE::Resize(size_t initial_size) {
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 size_t HASH_TABLE_TYPE::GetSize() {
-  auto header_page = reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id_, nullptr)->GetData());
-  return header_page->GetSize();
+  table_latch_.RLock();
+  size_t size = num_buckets_;
+  table_latch_.RUnlock();
+  return size;
 }
 
 template class LinearProbeHashTable<int, int, IntComparator>;
@@ -0,0 +1,85 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_access_strategy.h
+//
+// Identification: src/include/buffer/buffer_access_strategy.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+
+/**
+ * BufferAccessStrategy is a small private ring of buffer pool frames used by one bulk operation, such as a sequential
+ * scan. When a page fetched through the strategy misses, the buffer pool recycles the ring's next frame instead of
+ * asking the replacer for a victim, so a scan much larger than the pool only ever displaces the frames of its own
+ * ring and leaves the rest of the pool (the hot set) alone. Pages that are already resident are used in place.
+ *
+ * A strategy may be shared by copies of the same iterator, so the ring is latched.
+ */
+class BufferAccessStrategy {
+ public:
+  /**
+   * Creates a new strategy.
+   * @param ring_size the number of frames in the ring
+   */
+  explicit BufferAccessStrategy(size_t ring_size) : ring_(std::max<size_t>(ring_size, 1), {nullptr, -1}) {}
+
+  /**
+   * @param pool_size the size of the buffer pool the strategy is used with
+   * @return the ring size for bulk reads: SCAN_RING_SIZE frames, but never more than 1/8 of the pool
+   */
+  static size_t BulkReadRingSize(size_t pool_size) {
+    return std::max<size_t>(1, std::min<size_t>(SCAN_RING_SIZE, pool_size / 8));
+  }
+
+  /** @return the number of frames in the ring */
+  size_t GetRingSize() const { return ring_.size(); }
+
+  /**
+   * @return how many pages ahead a scan using this ring may prefetch: PREFETCH_DEPTH, but never more than half the
+   * ring, so that pages read ahead are not recycled before the scan reaches them
+   */
+  size_t GetPrefetchDepth() const { return std::min<size_t>(PREFETCH_DEPTH, ring_.size() / 2); }
+
+  DISALLOW_COPY_AND_MOVE(BufferAccessStrategy);
+
+ private:
+  friend class BufferPoolManager;
+
+  /** A frame of the ring, identified by the buffer pool (or shard) that owns it. */
+  using RingSlot = std::pair<BufferPoolManager *, frame_id_t>;
+
+  /**
+   * Advances the ring.
+   * @return the slot the next miss should be served from
+   */
+  RingSlot *NextSlot() {
+    current_ = (current_ + 1) % ring_.size();
+    return &ring_[current_];
+  }
+
+  /** Frames of the ring; {nullptr, -1} until the slot is first filled. */
+  std::vector<RingSlot> ring_;
+  /** Index of the slot most recently handed out. */
+  size_t current_{0};
+  /** Protects the ring. */
+  std::mutex latch_;
+};
+
+}  // namespace bustub
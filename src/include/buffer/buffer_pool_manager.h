@@ -12,14 +12,27 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <list>
-#include <mutex>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "buffer/buffer_access_strategy.h"
+#include "buffer/buffer_pool_stats.h"
 #include "buffer/clock_replacer.h"
+#include "buffer/frame_arena.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/page_table.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
@@ -27,22 +40,41 @@ namespace bustub {
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
  */
 class BufferPoolManager {
+  friend class ParallelBufferPoolManager;
+
  public:
   enum class CallbackType { BEFORE, AFTER };
   using bufferpool_callback_fn = void (*)(enum CallbackType, const page_id_t page_id);
+  /** Reads the id of the page that follows the given page in a chain of pages, or INVALID_PAGE_ID at its end. */
+  using next_page_id_fn = page_id_t (*)(Page *page);
 
   /**
    * Creates a new BufferPoolManager.
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used to pick victim frames
+   */
+  BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                    ReplacerType replacer_type = ReplacerType::CLOCK);
+
+  /**
+   * Creates a new BufferPoolManager that is one shard of a ParallelBufferPoolManager.
+   * Pages created by this shard have ids congruent to instance_index modulo num_instances.
+   * @param pool_size the size of the buffer pool
+   * @param num_instances the total number of shards
+   * @param instance_index the index of this shard, in [0, num_instances)
+   * @param disk_manager the disk manager
+   * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used to pick victim frames
    */
-  BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr);
+  BufferPoolManager(size_t pool_size, uint32_t num_instances, uint32_t instance_index, DiskManager *disk_manager,
+                    LogManager *log_manager = nullptr, ReplacerType replacer_type = ReplacerType::CLOCK);
 
   /**
    * Destroys an existing BufferPoolManager.
    */
-  ~BufferPoolManager();
+  virtual ~BufferPoolManager();
 
   /** Grading function. Do not modify! */
   Page *FetchPage(page_id_t page_id, bufferpool_callback_fn callback = nullptr) {
@@ -91,13 +123,138 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
+  /**
+   * Fetches a page on behalf of a bulk operation such as a sequential scan. Resident pages are returned as by
+   * FetchPage, but misses are loaded into a frame of the strategy's private ring instead of a victim chosen by the
+   * replacer.
+   * @param page_id id of page to be fetched
+   * @param strategy the caller's buffer access strategy; nullptr behaves exactly like FetchPage
+   * @return the requested page, nullptr if it could not be fetched
+   */
+  Page *FetchPageWithStrategy(page_id_t page_id, BufferAccessStrategy *strategy) {
+    return FetchPageWithStrategyImpl(page_id, strategy);
+  }
+
+  /**
+   * Fetches a page and wraps its pin in a guard, which unpins the page when it goes out of scope.
+   * @param page_id id of page to be fetched
+   * @param strategy the caller's buffer access strategy, nullptr if none
+   * @return a guard for the page; the guard is empty if the page could not be fetched
+   */
+  BasicPageGuard FetchPageBasic(page_id_t page_id, BufferAccessStrategy *strategy = nullptr);
+
+  /**
+   * Fetches a page and latches it for reading. The guard unlatches and unpins the page when it goes out of scope.
+   * @param page_id id of page to be fetched
+   * @param strategy the caller's buffer access strategy, nullptr if none
+   * @return a guard for the page; the guard is empty if the page could not be fetched
+   */
+  ReadPageGuard FetchPageRead(page_id_t page_id, BufferAccessStrategy *strategy = nullptr);
+
+  /**
+   * Fetches a page and latches it for writing. The guard unlatches and unpins the page when it goes out of scope,
+   * dirty if it was modified through the guard.
+   * @param page_id id of page to be fetched
+   * @return a guard for the page; the guard is empty if the page could not be fetched
+   */
+  WritePageGuard FetchPageWrite(page_id_t page_id);
+
+  /**
+   * Creates a new page and wraps its pin in a guard. New pages are always unpinned dirty.
+   * @param[out] page_id id of created page
+   * @return a guard for the page; the guard is empty if every frame is pinned
+   */
+  BasicPageGuard NewPageGuarded(page_id_t *page_id);
+
+  /**
+   * Reserves a run of consecutive page ids on disk, which are contiguous in the database file. The pages are created
+   * one at a time with NewReservedPageGuarded, so that a structure growing page by page still ends up laid out
+   * sequentially.
+   * @param num_pages the number of pages to reserve
+   * @param tablespace the tablespace to reserve the pages in
+   * @return the id of the first reserved page, INVALID_PAGE_ID if the tablespace has no room for the run
+   */
+  page_id_t AllocateExtent(size_t num_pages, tablespace_id_t tablespace = DiskManager::MAIN_TABLESPACE) {
+    return disk_manager_->AllocateExtent(num_pages, tablespace);
+  }
+
+  /**
+   * Creates a new page with an id reserved by AllocateExtent and wraps its pin in a guard. New pages are always
+   * unpinned dirty.
+   * @param page_id the reserved id
+   * @return a guard for the page; the guard is empty if every frame is pinned, in which case the id stays reserved
+   */
+  BasicPageGuard NewReservedPageGuarded(page_id_t page_id);
+
+  /**
+   * Asks the background I/O thread to bring a page into the buffer pool, and optionally the pages after it in a chain
+   * of pages. The page is left unpinned, so it can be evicted again before anyone uses it. This is only a hint: it
+   * returns immediately and the request is dropped if the prefetch queue is full.
+   * @param page_id id of page to be prefetched
+   * @param strategy the buffer access strategy whose ring the pages are loaded into, nullptr for the shared pool
+   * @param chain_length the number of pages to prefetch, following next_page_id from page_id
+   * @param next_page_id reads the next page id of a page in the chain; only needed if chain_length > 1
+   */
+  void PrefetchPage(page_id_t page_id, std::shared_ptr<BufferAccessStrategy> strategy = nullptr,
+                    size_t chain_length = 1, next_page_id_fn next_page_id = nullptr) {
+    PrefetchPageImpl(PrefetchRequest{page_id, std::move(strategy), chain_length, next_page_id, this});
+  }
+
+  /**
+   * Starts the background writer, which writes dirty unpinned pages back to disk ahead of eviction until at least
+   * target_clean_fraction of the frames are free or clean, so that foreground evictions rarely have to write. A page
+   * whose LSN is not yet persistent is left alone while logging is enabled. Does nothing if the writer is running.
+   * @param target_clean_fraction the fraction of frames the writer tries to keep clean, in [0, 1]
+   */
+  virtual void StartBackgroundWriter(double target_clean_fraction = BG_WRITER_CLEAN_FRACTION);
+
+  /** Stops and joins the background writer, if it is running. */
+  virtual void StopBackgroundWriter();
+
+  /**
+   * Changes the number of frames of the buffer pool while it is in use. Growing hands the new frames to the free list.
+   * Shrinking retires the frames at the end of the pool: their pages are written back if dirty and dropped, and their
+   * memory is returned to the operating system. A retiring frame that is pinned keeps serving its page until it is
+   * unpinned, so shrinking waits for those pins; the caller must not hold any itself. Concurrent fetches go on as
+   * usual. Pages returned earlier stay valid for as long as they are pinned.
+   * @param new_size the new number of frames, in [1, GetMaxPoolSize()]
+   * @return false if new_size is out of range, true otherwise
+   */
+  virtual bool Resize(size_t new_size);
+
+  /**
+   * Takes a snapshot of the statistics of the buffer pool. The counters are summed up from per-thread stripes, so the
+   * hot paths never share a cache line for them; the gauges are read under the buffer pool latch.
+   * @return the statistics
+   */
+  virtual BufferPoolStats GetStats();
+
+  /**
+   * Starts logging GetStats() every stats_dump_interval through LOG_INFO. Does nothing if the dump is running.
+   */
+  void StartStatsDump();
+
+  /** Stops and joins the statistics dump thread, if it is running. */
+  void StopStatsDump();
+
   /** @return pointer to all the pages in the buffer pool */
   Page *GetPages() { return pages_; }
 
   /** @return size of the buffer pool */
   size_t GetPoolSize() { return pool_size_; }
 
+  /** @return the size the buffer pool can grow to, which is BUFFER_POOL_MAX_GROWTH times its initial size */
+  size_t GetMaxPoolSize() { return max_pool_size_; }
+
  protected:
+  /**
+   * Creates a BufferPoolManager that owns no frames of its own. Subclasses which route every request to other buffer
+   * pools use this and set pool_size_ and max_pool_size_ to the total number of frames they can reach.
+   * @param disk_manager the disk manager
+   * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   */
+  BufferPoolManager(DiskManager *disk_manager, LogManager *log_manager);
+
   /**
    * Grading function. Do not modify!
    * Invokes the callback function if it is not null.
@@ -114,9 +271,17 @@ class BufferPoolManager {
   /**
    * Fetch the requested page from the buffer pool.
    * @param page_id id of page to be fetched
-   * @return the requested page
+   * @return the requested page, nullptr if every frame is pinned or the page failed its checksum
+   */
+  virtual Page *FetchPageImpl(page_id_t page_id);
+
+  /**
+   * Fetch the requested page from the buffer pool, recycling a frame of the strategy's ring on a miss.
+   * @param page_id id of page to be fetched
+   * @param strategy the buffer access strategy, or nullptr to use the replacer
+   * @return the requested page, nullptr if every frame is pinned or the page failed its checksum
    */
-  Page *FetchPageImpl(page_id_t page_id);
+  virtual Page *FetchPageWithStrategyImpl(page_id_t page_id, BufferAccessStrategy *strategy);
 
   /**
    * Unpin the target page from the buffer pool.
@@ -124,49 +289,275 @@ class BufferPoolManager {
    * @param is_dirty true if the page should be marked as dirty, false otherwise
    * @return false if the page pin count is <= 0 before this call, true otherwise
    */
-  bool UnpinPageImpl(page_id_t page_id, bool is_dirty);
+  virtual bool UnpinPageImpl(page_id_t page_id, bool is_dirty);
 
   /**
    * Flushes the target page to disk.
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
    * @return false if the page could not be found in the page table, true otherwise
    */
-  bool FlushPageImpl(page_id_t page_id);
+  virtual bool FlushPageImpl(page_id_t page_id);
 
   /**
    * Creates a new page in the buffer pool.
    * @param[out] page_id id of created page
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
-  Page *NewPageImpl(page_id_t *page_id);
+  virtual Page *NewPageImpl(page_id_t *page_id);
+
+  /**
+   * Creates a new page in the buffer pool with an id that was already allocated on disk.
+   * @param page_id id of the page to create
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  virtual Page *NewReservedPageImpl(page_id_t page_id);
+
+  /** A pending prefetch. */
+  struct PrefetchRequest {
+    page_id_t page_id_;
+    std::shared_ptr<BufferAccessStrategy> strategy_;
+    size_t chain_length_;
+    next_page_id_fn next_page_id_;
+    /** The buffer pool the request was made to, which routes the next page of the chain to its shard. */
+    BufferPoolManager *pool_;
+  };
+
+  /**
+   * Queues a prefetch for the background I/O thread, starting the thread on first use.
+   * @param request the prefetch to perform
+   */
+  virtual void PrefetchPageImpl(PrefetchRequest request);
 
   /**
    * Deletes a page from the buffer pool.
    * @param page_id id of page to be deleted
    * @return false if the page exists but could not be deleted, true if the page didn't exist or deletion succeeded
    */
-  bool DeletePageImpl(page_id_t page_id);
+  virtual bool DeletePageImpl(page_id_t page_id);
 
   /**
    * Flushes all the pages in the buffer pool to disk.
    */
-  void FlushAllPagesImpl();
+  virtual void FlushAllPagesImpl();
+
+  /**
+   * Allocates a page id for a new page. Shards only hand out ids that map back to themselves.
+   * @return the id of the allocated page
+   */
+  page_id_t AllocatePage();
+
+  /**
+   * Creates a new page in a frame of the buffer pool.
+   * @param[in,out] page_id id of the page; allocated here if allocate is true
+   * @param allocate true to allocate a new page id, false to use the one given
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  Page *CreatePage(page_id_t *page_id, bool allocate);
+
+  /** I/O state of a frame. Frames that are not READY are pinned by the thread doing their I/O. */
+  enum class FrameState : uint8_t {
+    /** The frame holds the page named by its page id and may be used. */
+    READY,
+    /** The frame's previous page is being written back; its contents do not belong to its page id yet. */
+    WRITING,
+    /** The frame's page is being read in from disk, or its memory is being reset for a new page. */
+    READING
+  };
+
+  /**
+   * Acquires latch_, recording in the statistics whether and how long the caller had to wait for it.
+   * @return the held lock
+   */
+  std::unique_lock<std::mutex> LockLatch();
+
+  /** Body of the statistics dump thread. */
+  void RunStatsDump();
+
+  /** Pin count of a frame that is claimed for reassignment. */
+  static constexpr int FRAME_CLAIMED = -1;
+
+  /**
+   * Pins a resident page without taking latch_, using a lock-free page table lookup. The pin only sticks if the frame
+   * still holds the page afterwards and has no I/O in flight; otherwise it is undone and the caller has to take the
+   * slow path under latch_.
+   * @param page_id id of the page
+   * @return the pinned page, nullptr if the fast path did not work out
+   */
+  Page *TryPinResident(page_id_t page_id);
+
+  /**
+   * Claims an unpinned frame before giving it to another page, or to no page at all. The claim moves the pin count
+   * from 0 to FRAME_CLAIMED, which keeps TryPinResident from pinning the frame until a new pin count is stored. Must
+   * be called with latch_ held.
+   * @param frame_id the frame to claim
+   * @return false if the frame is pinned, possibly only for a moment by a TryPinResident that is about to back off
+   */
+  bool ClaimFrame(frame_id_t frame_id) {
+    int unpinned = 0;
+    return pages_[frame_id].pin_count_.compare_exchange_strong(unpinned, FRAME_CLAIMED);
+  }
+
+  /**
+   * Finds a frame to hold a new page and removes its old page from the page table. With a strategy, the ring's next
+   * frame is recycled if it is still unpinned; otherwise (and without a strategy) the frame comes from the free list
+   * first and the replacer second, and becomes part of the ring. The frame is pinned in the replacer and claimed; the
+   * caller updates the page id before it stores the new pin count. Must be called with latch_ held.
+   * @param strategy the caller's buffer access strategy, nullptr if none
+   * @param[out] frame_id id of the frame found
+   * @param[out] old_page_id id of the page previously held by the frame, INVALID_PAGE_ID if none
+   * @param[out] old_is_dirty true if the old page must be written back before the frame is reused
+   * @return false if every frame is pinned, true otherwise
+   */
+  bool AcquireFrame(BufferAccessStrategy *strategy, frame_id_t *frame_id, page_id_t *old_page_id, bool *old_is_dirty);
 
-  /** Number of pages in the buffer pool. */
-  size_t pool_size_;
-  /** Array of buffer pool pages. */
+  /**
+   * Drops a page that failed its checksum while it was read in: removes it from the page table, wakes its waiters and
+   * returns the frame to the free list once they have let go of it. Must be called with latch_ held and the loader's
+   * pin on the frame.
+   * @param lock the held lock on latch_, which is released while waiting for other pins to go
+   * @param frame_id id of the frame that holds the page
+   */
+  void DiscardFrame(std::unique_lock<std::mutex> *lock, frame_id_t frame_id);
+
+  /**
+   * Writes the previous page of a reused frame back to disk with latch_ released. While the write is in flight,
+   * fetchers of the old page wait for it instead of reading stale contents from disk.
+   * @param lock the held lock on latch_, which is released during the write and held again on return
+   * @param frame_id id of the frame being reused
+   * @param old_page_id id of the page being written back
+   */
+  void WriteBackFrame(std::unique_lock<std::mutex> *lock, frame_id_t frame_id, page_id_t old_page_id);
+
+  /**
+   * Waits until no eviction is writing a page back. A page id must not be deallocated or given to a new page while
+   * the write of its old contents is in flight, or that write could land after the new page's own writes.
+   * @param lock the held lock on latch_, which is released while waiting
+   * @param page_id id of the page
+   */
+  void WaitForWriteBack(std::unique_lock<std::mutex> *lock, page_id_t page_id);
+
+  /** A dirty page held for writing by FlushAllPages. */
+  struct DirtyPage {
+    page_id_t page_id_;
+    /** The buffer pool (shard) holding the page. */
+    BufferPoolManager *pool_;
+    frame_id_t frame_id_;
+  };
+
+  /**
+   * Pins a frame and marks it clean ahead of writing it back, so that it can neither be evicted nor lose a later
+   * modification while it is written. The pin does not count as an access. Must be called with latch_ held.
+   * @param frame_id the frame to hold
+   */
+  void HoldFrameForWrite(frame_id_t frame_id);
+
+  /**
+   * @param frame_id id of a frame
+   * @return true if the frame lies beyond the end of the pool, i.e. a shrinking Resize is retiring it. Unpinning such a
+   * frame wakes up Resize instead of handing the frame to the replacer.
+   */
+  bool IsRetired(frame_id_t frame_id) const { return static_cast<size_t>(frame_id) >= pool_size_; }
+
+  /**
+   * Drops the pin taken by HoldFrameForWrite. Must be called with latch_ held.
+   * @param frame_id the frame to release
+   */
+  void ReleaseFrame(frame_id_t frame_id);
+
+  /**
+   * Holds every dirty page of this buffer pool for writing.
+   * @param[out] pages the held pages are appended here
+   */
+  void HoldDirtyPages(std::vector<DirtyPage> *pages);
+
+  /**
+   * Writes held dirty pages back in page id order, coalescing runs of consecutive page ids into single vectored
+   * writes, releases them, and syncs the database file once at the end. Each page is copied out under its read latch,
+   * FLUSH_BATCH_SIZE pages at a time, so no page latch is held during the writes.
+   * @param pages the pages to write; sorted in place
+   */
+  void WriteDirtyPages(std::vector<DirtyPage> *pages);
+
+  /** Body of the background writer: cleans frames until StopBackgroundWriter is called. */
+  void RunBackgroundWriter();
+
+  /**
+   * Picks the dirty frames the background writer should write next, sweeping the frames from where the previous sweep
+   * stopped. The frames are held with HoldFrameForWrite. Must be called with latch_ held.
+   * @return the frames to write, empty if enough frames are clean already or nothing can be written yet
+   */
+  std::vector<frame_id_t> PickFramesToClean();
+
+  /** Body of the background I/O thread: serves prefetch requests until StopPrefetchThread is called. */
+  void RunPrefetchThread();
+
+  /** Stops and joins the background I/O thread. Later prefetch requests are dropped. */
+  void StopPrefetchThread();
+
+  /** Number of pages in the buffer pool. Frames at or above it are retired. Only changed with latch_ held. */
+  std::atomic<size_t> pool_size_;
+  /** Number of frames reserved at construction, which bounds how far the pool can grow. */
+  size_t max_pool_size_;
+  /** Number of shards this buffer pool belongs to (1 if it is not part of a ParallelBufferPoolManager). */
+  const uint32_t num_instances_ = 1;
+  /** Index of this shard among its siblings. */
+  const uint32_t instance_index_ = 0;
+  /** Memory of the buffer pool frames. */
+  std::unique_ptr<FrameArena> arena_;
+  /** Array of buffer pool pages, one per frame of the arena, including frames that are not part of the pool yet. */
   Page *pages_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
   LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
+  /** Page table for keeping track of buffer pool pages. Changed with latch_ held, read without it by page hits. */
+  PageTable page_table_;
   /** Replacer to find unpinned pages for replacement. */
   Replacer *replacer_;
   /** List of free pages. */
   std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
+  /** I/O state of every frame. Changed with latch_ held, read without it by page hits. */
+  std::vector<std::atomic<FrameState>> frame_states_;
+  /** Signalled when a frame finishes an I/O, so waiters only wake up for the frame they care about. */
+  std::vector<std::condition_variable> frame_io_cv_;
+  /** Evicted pages whose dirty contents are still being written back, mapped to the frame doing the write. */
+  std::unordered_map<page_id_t, frame_id_t> writeback_table_;
+  /** Background writer thread, nullptr if it is not running. */
+  std::thread *bg_writer_thread_ = nullptr;
+  /** Fraction of frames the background writer keeps free or clean. */
+  double bg_writer_target_clean_ = 0;
+  /** True once the background writer has been told to exit. Protected by latch_. */
+  bool stop_bg_writer_ = false;
+  /** Frame where the background writer's next sweep starts. Protected by latch_. */
+  size_t bg_writer_cursor_ = 0;
+  /** Wakes the background writer early, e.g. when a foreground eviction had to write a dirty page. Uses latch_. */
+  std::condition_variable bg_writer_cv_;
+  /** Counters behind GetStats. */
+  BufferPoolStatsCollector stats_;
+  /** Statistics dump thread, nullptr if it is not running. */
+  std::thread *stats_dump_thread_ = nullptr;
+  /** True once the statistics dump thread has been told to exit. */
+  bool stop_stats_dump_ = false;
+  /** Protects the statistics dump thread and its stop flag. */
+  std::mutex stats_dump_latch_;
+  /** Wakes the statistics dump thread up to exit. */
+  std::condition_variable stats_dump_cv_;
+  /** Serializes calls to Resize. Acquired before latch_. */
+  std::mutex resize_latch_;
+  /** Prefetches waiting for the background I/O thread. */
+  std::deque<PrefetchRequest> prefetch_queue_;
+  /** Background I/O thread serving prefetch_queue_, started by the first prefetch. */
+  std::thread *prefetch_thread_ = nullptr;
+  /** True once the background I/O thread has been told to exit. */
+  bool stop_prefetch_ = false;
+  /** Protects the prefetch queue, thread and stop flag. */
+  std::mutex prefetch_latch_;
+  /** Signalled when a prefetch is queued or the background I/O thread should exit. */
+  std::condition_variable prefetch_cv_;
+  /**
+   * This latch protects the page table, free list, replacer, frame states, write-back table and the book-keeping
+   * fields of every page. It is never held across disk I/O.
+   */
   std::mutex latch_;
 };
 }  // namespace bustub
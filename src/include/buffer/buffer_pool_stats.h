@@ -0,0 +1,167 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.h
+//
+// Identification: src/include/buffer/buffer_pool_stats.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <string>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * LatencyHistogram counts latencies in power-of-two microsecond buckets: bucket 0 holds latencies under 1us, bucket i
+ * those in [2^(i-1), 2^i) us, and the last bucket everything longer.
+ */
+struct LatencyHistogram {
+  static constexpr size_t NUM_BUCKETS = 24;
+
+  /**
+   * @param nanos a latency in nanoseconds
+   * @return the bucket that counts it
+   */
+  static size_t BucketOf(uint64_t nanos);
+
+  /** Adds the counts of another histogram to this one. */
+  void Merge(const LatencyHistogram &other);
+
+  /**
+   * @param fraction the fraction of samples, in [0, 1]
+   * @return an upper bound in microseconds on the latency of that fraction of the samples, 0 if there are none
+   */
+  uint64_t PercentileMicros(double fraction) const;
+
+  /** @return the mean latency in microseconds, 0 if there are no samples */
+  double MeanMicros() const { return count_ == 0 ? 0 : static_cast<double>(total_nanos_) / count_ / 1000; }
+
+  std::array<uint64_t, NUM_BUCKETS> buckets_{};
+  uint64_t count_{0};
+  uint64_t total_nanos_{0};
+};
+
+/**
+ * A snapshot of the statistics of a buffer pool, or of the sum over the shards of a ParallelBufferPoolManager. The
+ * counters are cumulative since the buffer pool was created; the gauges describe the pool at the time of the snapshot.
+ */
+struct BufferPoolStats {
+  /** Fetches of pages that were already resident. */
+  uint64_t hits_{0};
+  /** Fetches that had to read the page from disk. */
+  uint64_t misses_{0};
+  /** Pages dropped from their frame to make room for another page. */
+  uint64_t evictions_{0};
+  /** Evictions that had to write the page back first. */
+  uint64_t dirty_evictions_{0};
+  /** Fetches that found their page in flight and waited for a read or write-back to finish. */
+  uint64_t pin_waits_{0};
+  /** Acquisitions of the buffer pool latch that found it held. */
+  uint64_t latch_waits_{0};
+  /** Time spent waiting for the buffer pool latch, in nanoseconds. */
+  uint64_t latch_wait_nanos_{0};
+  /** Pages read from disk whose checksum did not match their contents. */
+  uint64_t checksum_failures_{0};
+  /** Latencies of the page reads issued by the buffer pool. */
+  LatencyHistogram read_latency_;
+  /** Latencies of the page writes issued by the buffer pool, including write-backs and the background writer. */
+  LatencyHistogram write_latency_;
+
+  /** Number of frames. */
+  size_t pool_size_{0};
+  /** Frames that hold a page. */
+  size_t resident_pages_{0};
+  /** Frames on the free list. */
+  size_t free_frames_{0};
+  /** Resident pages that are dirty. */
+  size_t dirty_pages_{0};
+
+  /** Adds the counters and gauges of another snapshot to this one. */
+  void Merge(const BufferPoolStats &other);
+
+  /** @return hits / (hits + misses), 0 if there were no fetches */
+  double HitRatio() const { return hits_ + misses_ == 0 ? 0 : static_cast<double>(hits_) / (hits_ + misses_); }
+
+  /** @return the snapshot on a single line, for logging */
+  std::string ToString() const;
+};
+
+/**
+ * BufferPoolStatsCollector gathers the counters of one buffer pool. Updates go to one of a few cache-line aligned
+ * stripes, picked per thread, as relaxed atomic increments; reading sums up the stripes. This keeps the hot paths free
+ * of shared cache lines at the cost of a slightly slower GetStats.
+ */
+class BufferPoolStatsCollector {
+ public:
+  enum Counter {
+    HITS,
+    MISSES,
+    EVICTIONS,
+    DIRTY_EVICTIONS,
+    PIN_WAITS,
+    LATCH_WAITS,
+    LATCH_WAIT_NANOS,
+    CHECKSUM_FAILURES,
+    NUM_COUNTERS
+  };
+
+  BufferPoolStatsCollector() = default;
+
+  DISALLOW_COPY_AND_MOVE(BufferPoolStatsCollector);
+
+  /**
+   * Adds to a counter.
+   * @param counter the counter
+   * @param amount the amount to add
+   */
+  void Add(Counter counter, uint64_t amount = 1) {
+    GetStripe().counters_[counter].fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  /** Records the latency of a page read that started at start. */
+  void RecordRead(std::chrono::steady_clock::time_point start) { Record(&GetStripe().reads_, start); }
+
+  /** Records the latency of a page write that started at start. */
+  void RecordWrite(std::chrono::steady_clock::time_point start) { Record(&GetStripe().writes_, start); }
+
+  /**
+   * Sums up the counters and histograms. Concurrent updates may or may not be included.
+   * @param[out] stats the snapshot to fill in; its gauges are left alone
+   */
+  void Collect(BufferPoolStats *stats) const;
+
+ private:
+  static constexpr size_t NUM_STRIPES = 16;
+
+  struct StripeHistogram {
+    std::array<std::atomic<uint64_t>, LatencyHistogram::NUM_BUCKETS> buckets_{};
+    std::atomic<uint64_t> total_nanos_{0};
+  };
+
+  struct alignas(CACHELINE_SIZE) Stripe {
+    std::array<std::atomic<uint64_t>, NUM_COUNTERS> counters_{};
+    StripeHistogram reads_;
+    StripeHistogram writes_;
+  };
+
+  /** @return the stripe of the calling thread; threads are spread over the stripes round-robin */
+  Stripe &GetStripe();
+
+  static void Record(StripeHistogram *histogram, std::chrono::steady_clock::time_point start);
+
+  std::array<Stripe, NUM_STRIPES> stripes_;
+};
+
+}  // namespace bustub
@@ -12,11 +12,9 @@
 
 #pragma once
 
-#include <list>
-#include <mutex>  // NOLINT
+#include <atomic>
+#include <cstdint>
 #include <vector>
-#include <unordered_map>
-#include <mutex>
 
 #include "buffer/replacer.h"
 #include "common/config.h"
@@ -25,6 +23,10 @@ namespace bustub {
 
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the Least Recently Used policy.
+ *
+ * Every frame owns one atomic state byte, indexed directly by its frame id, that holds an "in the clock" bit and a
+ * reference bit. Pin and Unpin are a single atomic read-modify-write on that byte, so they never wait. Victim sweeps
+ * the clock hand over the array, clearing reference bits until it finds an unreferenced frame in the clock.
  */
 class ClockReplacer : public Replacer {
  public:
@@ -45,17 +47,24 @@ class ClockReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  void SetEvictable(frame_id_t frame_id, bool evictable) override;
+
   size_t Size() override;
 
  private:
- std::unordered_map<frame_id_t, bool> hash;
- std::vector<frame_id_t> lst;
- size_t ref=0;
- size_t num_page=0;
- frame_id_t temp;
- std::mutex mtx;
-
-  // TODO(student): implement me!
+  /** Set while the frame is unpinned, i.e. it is in the clock and may be victimized. */
+  static constexpr uint8_t IN_CLOCK = 0x1;
+  /** Set when the frame is unpinned, cleared when the clock hand passes over it. */
+  static constexpr uint8_t REFERENCED = 0x2;
+
+  /** Number of frames tracked by the clock. */
+  const size_t num_frames_;
+  /** State byte of every frame, indexed by frame id. */
+  std::vector<std::atomic<uint8_t>> frames_;
+  /** Position of the clock hand; taken modulo num_frames_. */
+  std::atomic<size_t> clock_hand_{0};
+  /** Number of frames in the clock. */
+  std::atomic<size_t> size_{0};
 };
 
 }  // namespace bustub
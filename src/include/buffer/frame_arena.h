@@ -0,0 +1,79 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.h
+//
+// Identification: src/include/buffer/frame_arena.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * FrameArena is the memory behind the frames of a buffer pool: one page-aligned, zero-filled region of
+ * num_frames * PAGE_SIZE bytes, mapped directly from the kernel instead of the heap.
+ *
+ * The arena may be mapped larger than the buffer pool currently is: memory that is never touched is not backed by
+ * anything, so a pool reserves room to grow without paying for it up front.
+ *
+ * Arenas of at least HUGE_PAGE_SIZE bytes are backed by explicit huge pages (MAP_HUGETLB) if the system has some
+ * reserved, and otherwise ask for transparent huge pages, which cuts TLB misses for large pools. An arena can also
+ * prefer a NUMA node, so that each shard of a ParallelBufferPoolManager keeps its frames close to one socket.
+ */
+class FrameArena {
+ public:
+  /** Size of a huge page; smaller arenas are not worth backing by huge pages. */
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  /**
+   * Maps a new arena.
+   * @param num_frames the number of frames in the arena
+   * @param numa_node the NUMA node the frames should be placed on, or -1 for the default placement
+   */
+  explicit FrameArena(size_t num_frames, int numa_node = -1);
+
+  /** Unmaps the arena. */
+  ~FrameArena();
+
+  DISALLOW_COPY_AND_MOVE(FrameArena);
+
+  /**
+   * @param frame_id id of a frame in the arena
+   * @return the PAGE_SIZE bytes of the frame
+   */
+  char *GetFrameData(frame_id_t frame_id) { return data_ + static_cast<size_t>(frame_id) * PAGE_SIZE; }
+
+  /**
+   * Returns the memory of a range of frames to the operating system. The frames stay mapped and read as zeroes when
+   * they are used again.
+   * @param first_frame id of the first frame to release
+   * @param num_frames the number of frames to release
+   */
+  void Release(frame_id_t first_frame, size_t num_frames);
+
+  /** @return true if the arena is backed by explicit huge pages */
+  bool IsHugePageBacked() const { return huge_pages_; }
+
+  /** @return the number of NUMA nodes of this machine, 1 if it cannot be determined */
+  static int GetNumaNodeCount();
+
+ private:
+  /** Start of the mapping. */
+  char *data_{nullptr};
+  /** Length of the mapping, which may be rounded up past the last frame. */
+  size_t size_{0};
+  /** True if the mapping uses MAP_HUGETLB. */
+  bool huge_pages_{false};
+};
+
+}  // namespace bustub
@@ -0,0 +1,106 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <deque>
+#include <mutex>  // NOLINT
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy.
+ *
+ * The backward K-distance of a frame is the time elapsed since its K-th most recent access. Frames with fewer than K
+ * accesses have a backward K-distance of +inf. The victim is the evictable frame with the largest backward K-distance;
+ * ties between +inf frames are broken by evicting the frame whose first access is the oldest (plain LRU).
+ *
+ * An access is recorded every time a frame is pinned. A frame touched once by a sequential scan therefore stays at
+ * +inf and is evicted before any frame of the hot set that has been accessed K times.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param k the number of accesses remembered per frame
+   */
+  explicit LRUKReplacer(size_t num_pages, size_t k = LRUK_REPLACER_K);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  /**
+   * Takes the frame with the largest backward K-distance out of the eviction queues. Its history is kept until Remove,
+   * so that a victim pinned again before the buffer pool claims it does not come back as a cold frame.
+   */
+  bool Victim(frame_id_t *frame_id) override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  void SetEvictable(frame_id_t frame_id, bool evictable) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  size_t Size() override;
+
+ private:
+  /** Access history of one frame. */
+  struct FrameHistory {
+    /** Timestamps of the last (up to) K accesses, oldest first. */
+    std::deque<size_t> accesses_;
+    /** True if the frame is unpinned and may be victimized. */
+    bool evictable_{false};
+  };
+
+  /** Ordered by eviction priority: the smallest timestamp is evicted first. */
+  using EvictionQueue = std::set<std::pair<size_t, frame_id_t>>;
+
+  /**
+   * @param history the frame's history
+   * @return the queue an evictable frame with this history belongs to
+   */
+  EvictionQueue *QueueFor(const FrameHistory &history) {
+    return history.accesses_.size() < k_ ? &infinite_queue_ : &finite_queue_;
+  }
+
+  /** Removes an evictable frame from its eviction queue. */
+  void Dequeue(frame_id_t frame_id);
+
+  /** Adds an evictable frame to its eviction queue. */
+  void Enqueue(frame_id_t frame_id);
+
+  /** Number of accesses remembered per frame. */
+  const size_t k_;
+  /** Logical clock, incremented on every access. */
+  size_t current_timestamp_{0};
+  /** History of every frame, indexed by frame id. */
+  std::vector<FrameHistory> histories_;
+  /** Evictable frames with fewer than K accesses, keyed by their first access. */
+  EvictionQueue infinite_queue_;
+  /** Evictable frames with K accesses, keyed by their K-th most recent access. */
+  EvictionQueue finite_queue_;
+  /** Protects all of the above. */
+  std::mutex latch_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// mmap_buffer_pool_manager.h
+//
+// Identification: src/include/buffer/mmap_buffer_pool_manager.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "buffer/buffer_pool_manager.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * MmapBufferPoolManager serves the pages of a database file that its DiskManager has mapped into memory
+ * (DiskIOMode::MMAP_READ_ONLY), for read-only replicas. Fetching a page returns a view whose data points straight into
+ * the mapping: nothing is copied, nothing is evicted, and there is no latch on the fetch path. The kernel's page cache
+ * takes the place of the frames, and scan prefetches become read-ahead hints for the mapping.
+ *
+ * Pages cannot be created, deleted or modified; writing to the data of a page faults. The page latches and pin counts
+ * work as usual.
+ */
+class MmapBufferPoolManager : public BufferPoolManager {
+ public:
+  /**
+   * Creates a new MmapBufferPoolManager.
+   * @param disk_manager the disk manager, which must have been opened in DiskIOMode::MMAP_READ_ONLY
+   */
+  explicit MmapBufferPoolManager(DiskManager *disk_manager);
+
+  /**
+   * Destroys the MmapBufferPoolManager and its page views.
+   */
+  ~MmapBufferPoolManager() override;
+
+  /** The pool always spans the whole mapping. @return false */
+  bool Resize(size_t new_size) override { return false; }
+
+  /** @return the statistics of the pool; every fetch is a hit, and resident pages are the pages viewed so far */
+  BufferPoolStats GetStats() override;
+
+  /** There is nothing to write back. */
+  void StartBackgroundWriter(double target_clean_fraction = BG_WRITER_CLEAN_FRACTION) override {}
+
+  void StopBackgroundWriter() override {}
+
+ protected:
+  Page *FetchPageImpl(page_id_t page_id) override;
+
+  /** Same as FetchPageImpl; a scan's ring is not needed since nothing is evicted. */
+  Page *FetchPageWithStrategyImpl(page_id_t page_id, BufferAccessStrategy *strategy) override;
+
+  /** Unpins the page. is_dirty is ignored, since mapped pages cannot be modified. */
+  bool UnpinPageImpl(page_id_t page_id, bool is_dirty) override;
+
+  /** @return true if the page is mapped; there is nothing to write */
+  bool FlushPageImpl(page_id_t page_id) override;
+
+  /** @return nullptr, since the database is read-only */
+  Page *NewPageImpl(page_id_t *page_id) override;
+
+  /** @return nullptr, since the database is read-only */
+  Page *NewReservedPageImpl(page_id_t page_id) override;
+
+  /** @return false, since the database is read-only */
+  bool DeletePageImpl(page_id_t page_id) override;
+
+  void FlushAllPagesImpl() override {}
+
+  /** Asks the kernel to read ahead the pages of the chain, which lie next to each other when they come from extents. */
+  void PrefetchPageImpl(PrefetchRequest request) override;
+
+ private:
+  /**
+   * @param page_id id of a page
+   * @return the view of the page, created on first use; nullptr if the page is not mapped or fails its checksum
+   */
+  Page *GetView(page_id_t page_id);
+
+  /** Number of mapped pages. */
+  size_t num_pages_;
+  /** View of every mapped page, nullptr until the page is first fetched. */
+  std::unique_ptr<std::atomic<Page *>[]> views_;
+  /** Number of views created. */
+  std::atomic<size_t> num_views_{0};
+};
+
+}  // namespace bustub
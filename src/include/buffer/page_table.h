@@ -0,0 +1,114 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.h
+//
+// Identification: src/include/buffer/page_table.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * PageTable maps the ids of the pages in a buffer pool to their frames. It is a fixed-capacity, open-addressing hash
+ * table with linear probing, where every slot packs a page id and a frame id into one atomic word.
+ *
+ * Lookups take no lock. Insert and Erase must be serialized by the caller (the buffer pool latch). Since erasing
+ * shifts later entries of a probe run backwards, a concurrent lookup can miss an entry that is being moved. Lookups
+ * without the caller's lock are therefore only hints: a miss must be confirmed with the lock held, and a hit must be
+ * validated against the frame.
+ */
+class PageTable {
+ public:
+  /**
+   * Creates an empty page table.
+   * @param max_entries the largest number of entries the table will hold, i.e. the number of frames
+   */
+  explicit PageTable(size_t max_entries);
+
+  DISALLOW_COPY_AND_MOVE(PageTable);
+
+  /**
+   * Looks up a page. Safe to call without the lock that serializes writers.
+   * @param page_id the page to look up
+   * @param[out] frame_id the frame holding the page
+   * @return true if the page was found
+   */
+  bool Find(page_id_t page_id, frame_id_t *frame_id) const;
+
+  /**
+   * Adds a page or moves it to another frame.
+   * @param page_id the page
+   * @param frame_id the frame now holding the page
+   */
+  void Insert(page_id_t page_id, frame_id_t frame_id);
+
+  /**
+   * Removes a page.
+   * @param page_id the page
+   * @return true if the page was in the table
+   */
+  bool Erase(page_id_t page_id);
+
+  /** @return the number of entries; only exact with the writers' lock held */
+  size_t Size() const { return size_; }
+
+  /**
+   * Calls fn(page_id, frame_id) for every entry. Must be called with the writers' lock held.
+   * @param fn the function to call
+   */
+  template <typename Fn>
+  void ForEach(Fn &&fn) const {
+    for (size_t i = 0; i < capacity_; ++i) {
+      uint64_t entry = slots_[i].load(std::memory_order_relaxed);
+      if (entry != EMPTY) {
+        fn(KeyOf(entry), FrameOf(entry));
+      }
+    }
+  }
+
+ private:
+  /** A slot without an entry. Its page id half is INVALID_PAGE_ID, which is never a key. */
+  static constexpr uint64_t EMPTY = ~0ULL;
+
+  static uint64_t MakeEntry(page_id_t page_id, frame_id_t frame_id) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(page_id)) << 32 | static_cast<uint32_t>(frame_id);
+  }
+  static page_id_t KeyOf(uint64_t entry) { return static_cast<page_id_t>(entry >> 32); }
+  static frame_id_t FrameOf(uint64_t entry) { return static_cast<frame_id_t>(entry & 0xFFFFFFFF); }
+
+  /** @return the slot where the probe for page_id starts */
+  size_t HomeSlot(page_id_t page_id) const {
+    // Fibonacci hashing spreads the mostly consecutive page ids over the whole table.
+    return static_cast<size_t>((static_cast<uint32_t>(page_id) * 0x9E3779B97F4A7C15ULL) >> shift_);
+  }
+
+  /**
+   * Finds the slot of a page, or the empty slot that ends its probe run. Must be called with the writers' lock held.
+   * @return the index of the slot
+   */
+  size_t FindSlot(page_id_t page_id) const;
+
+  /** Number of slots, a power of two at least twice the maximum number of entries. */
+  size_t capacity_;
+  /** Shift that turns a 64-bit hash into a slot index. */
+  int shift_;
+  /** Number of entries. Only changed by writers. */
+  std::atomic<size_t> size_{0};
+  /** The slots. */
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,105 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// parallel_buffer_pool_manager.h
+//
+// Identification: src/include/buffer/parallel_buffer_pool_manager.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * ParallelBufferPoolManager splits the buffer pool into several independent BufferPoolManager shards, each with its
+ * own latch, page table, free list and replacer. A page lives in the shard given by page_id % num_instances, so
+ * threads touching different pages rarely contend on the same latch.
+ */
+class ParallelBufferPoolManager : public BufferPoolManager {
+ public:
+  /**
+   * Creates a new ParallelBufferPoolManager.
+   * @param num_instances the number of shards
+   * @param pool_size the size of each shard
+   * @param disk_manager the disk manager
+   * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used by every shard
+   */
+  ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
+                            LogManager *log_manager = nullptr, ReplacerType replacer_type = ReplacerType::CLOCK);
+
+  /**
+   * Destroys an existing ParallelBufferPoolManager and all of its shards.
+   */
+  ~ParallelBufferPoolManager() override;
+
+  /** @return the number of shards */
+  size_t GetNumInstances() const { return instances_.size(); }
+
+  /**
+   * @param page_id id of a page
+   * @return the shard responsible for the page
+   */
+  BufferPoolManager *GetBufferPoolManager(page_id_t page_id);
+
+  /**
+   * Resizes the shards so that together they have new_size frames, spread as evenly as possible.
+   * @param new_size the new total number of frames, in [GetNumInstances(), GetMaxPoolSize()]
+   * @return false if new_size is out of range, true otherwise
+   */
+  bool Resize(size_t new_size) override;
+
+  /** @return the sum of the statistics of every shard */
+  BufferPoolStats GetStats() override;
+
+  /** Starts a background writer in every shard. */
+  void StartBackgroundWriter(double target_clean_fraction = BG_WRITER_CLEAN_FRACTION) override;
+
+  /** Stops the background writer of every shard. */
+  void StopBackgroundWriter() override;
+
+ protected:
+  Page *FetchPageImpl(page_id_t page_id) override;
+
+  Page *FetchPageWithStrategyImpl(page_id_t page_id, BufferAccessStrategy *strategy) override;
+
+  bool UnpinPageImpl(page_id_t page_id, bool is_dirty) override;
+
+  bool FlushPageImpl(page_id_t page_id) override;
+
+  /**
+   * Creates a new page in one of the shards. Shards are tried in round-robin order starting one past the shard used
+   * by the previous call, so new pages spread evenly and a full shard does not fail the request.
+   * @param[out] page_id id of created page
+   * @return nullptr if every shard is full, otherwise pointer to new page
+   */
+  Page *NewPageImpl(page_id_t *page_id) override;
+
+  Page *NewReservedPageImpl(page_id_t page_id) override;
+
+  bool DeletePageImpl(page_id_t page_id) override;
+
+  void FlushAllPagesImpl() override;
+
+  void PrefetchPageImpl(PrefetchRequest request) override;
+
+ private:
+  /** The shards. Shard i owns every page whose id is congruent to i modulo the number of shards. */
+  std::vector<BufferPoolManager *> instances_;
+  /** Shard that the next NewPage call tries first. */
+  std::atomic<size_t> next_instance_{0};
+};
+
+}  // namespace bustub
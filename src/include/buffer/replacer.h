@@ -16,6 +16,14 @@
 
 namespace bustub {
 
+/** Replacement policies a BufferPoolManager can be created with. */
+enum class ReplacerType {
+  /** ClockReplacer: cheap approximation of LRU. */
+  CLOCK,
+  /** LRUKReplacer: evicts by backward K-distance, which keeps one-off scans from flushing the hot set. */
+  LRU_K
+};
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -43,6 +51,26 @@ class Replacer {
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Removes a frame from the replacer and forgets everything known about it, e.g. because its page was deleted.
+   * @param frame_id the id of the frame to remove
+   */
+  virtual void Remove(frame_id_t frame_id) { Pin(frame_id); }
+
+  /**
+   * Makes a frame (non-)evictable without counting it as an access, e.g. while the buffer pool writes it back in the
+   * background. Replacers that keep access history should override this; the default treats it as a pin or unpin.
+   * @param frame_id the id of the frame
+   * @param evictable true if the frame may be victimized again
+   */
+  virtual void SetEvictable(frame_id_t frame_id, bool evictable) {
+    if (evictable) {
+      Unpin(frame_id);
+    } else {
+      Pin(frame_id);
+    }
+  }
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual size_t Size() = 0;
 };
@@ -33,6 +33,9 @@ struct TableMetadata {
 /**
  * SimpleCatalog is a non-persistent catalog that is designed for the executor to use.
  * It handles table creation and table lookup.
+ *
+ * Given a disk manager, the catalog keeps each table in a tablespace of its own, table oid + 1, so that every table has
+ * its own data file. Tables whose oid has no tablespace left go into the main tablespace.
  */
 class SimpleCatalog {
  public:
@@ -41,9 +44,17 @@ class SimpleCatalog {
    * @param bpm the buffer pool manager backing tables created by this catalog
    * @param lock_manager the lock manager in use by the system
    * @param log_manager the log manager in use by the system
+   * @param disk_manager the disk manager behind bpm to open a tablespace per table in, nullptr to keep all tables in
+   * the main tablespace
+   * @param tablespace_directory the directory of the tablespace files, the directory of the database file if empty
    */
-  SimpleCatalog(BufferPoolManager *bpm, LockManager *lock_manager, LogManager *log_manager)
-      : bpm_{bpm}, lock_manager_{lock_manager}, log_manager_{log_manager} {}
+  SimpleCatalog(BufferPoolManager *bpm, LockManager *lock_manager, LogManager *log_manager,
+                DiskManager *disk_manager = nullptr, std::string tablespace_directory = "")
+      : bpm_{bpm},
+        lock_manager_{lock_manager},
+        log_manager_{log_manager},
+        disk_manager_{disk_manager},
+        tablespace_directory_{std::move(tablespace_directory)} {}
 
   /**
    * Create a new table and return its metadata.
@@ -57,16 +68,23 @@ class SimpleCatalog {
     if(names_.count(table_name) > 0){
       return nullptr;
     }
-    names_[table_name] = next_table_oid_;
-    page_id_t myPage;
-    bpm_->NewPage(&myPage, nullptr);
+    table_oid_t oid = next_table_oid_++;
+    // A table whose tablespace cannot be opened, or is taken already, lives in the main tablespace.
+    tablespace_id_t tablespace = DiskManager::MAIN_TABLESPACE;
+    if (disk_manager_ != nullptr && disk_manager_->SupportsTablespaces() && oid + 1 < DiskManager::MAX_TABLESPACES &&
+        !disk_manager_->HasTablespace(oid + 1)) {
+      tablespace = oid + 1;
+      disk_manager_->OpenTablespace(tablespace, tablespace_directory_);
+    }
 
-    std::unique_ptr<TableHeap> myPtr(new TableHeap(bpm_, lock_manager_, log_manager_, myPage));
-    std::unique_ptr<TableMetadata> myMetaData(new TableMetadata(schema, table_name, move(myPtr), next_table_oid_));
-    tables_[next_table_oid_] = move(myMetaData);
-    next_table_oid_++;
+    std::unique_ptr<TableHeap> myPtr(new TableHeap(bpm_, lock_manager_, log_manager_, txn, tablespace));
+    std::unique_ptr<TableMetadata> myMetaData(new TableMetadata(schema, table_name, move(myPtr), oid));
+    TableMetadata *metadata = myMetaData.get();
+    tables_[oid] = move(myMetaData);
+    // The name is only registered once the table exists, so it never names a missing table.
+    names_[table_name] = oid;
 
-    return myMetaData.get();
+    return metadata;
 
   }
 
@@ -94,6 +112,8 @@ class SimpleCatalog {
   [[maybe_unused]] BufferPoolManager *bpm_;
   [[maybe_unused]] LockManager *lock_manager_;
   [[maybe_unused]] LogManager *log_manager_;
+  DiskManager *disk_manager_;
+  std::string tablespace_directory_;
 
   /** tables_ : table identifiers -> table metadata. Note that tables_ owns all table metadata. */
   std::unordered_map<table_oid_t, std::unique_ptr<TableMetadata>> tables_;
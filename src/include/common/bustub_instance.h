@@ -33,6 +33,7 @@ class BustubInstance {
     log_manager_ = new LogManager(disk_manager_);
 
     buffer_pool_manager_ = new BufferPoolManager(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
+    buffer_pool_manager_->StartBackgroundWriter();
 
     // txn related
     lock_manager_ = new LockManager(TwoPLMode::STRICT, DeadlockMode::PREVENTION);  // S2PL
@@ -43,6 +44,8 @@ class BustubInstance {
   }
 
   ~BustubInstance() {
+    // The background writer reads the persistent LSN, so it must stop before the log manager goes away.
+    buffer_pool_manager_->StopBackgroundWriter();
     if (enable_logging) {
       log_manager_->StopFlushThread();
     }
@@ -16,6 +16,11 @@
 #include <chrono>  // NOLINT
 #include <cstdint>
 
+/** Size of a page in bytes, set by the build (cmake -DBUSTUB_PAGE_SIZE=...). */
+#ifndef BUSTUB_PAGE_SIZE
+#define BUSTUB_PAGE_SIZE 4096
+#endif
+
 namespace bustub {
 
 /** Cycle detection is performed every CYCLE_DETECTION_INTERVAL milliseconds. */
@@ -27,20 +32,40 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** The buffer pool's background writer wakes up at least every BG_WRITER_INTERVAL milliseconds. */
+extern std::chrono::milliseconds bg_writer_interval;
+
+/** A buffer pool with statistics dumps enabled logs its statistics every STATS_DUMP_INTERVAL milliseconds. */
+extern std::chrono::milliseconds stats_dump_interval;
+
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
 static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
-static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
+static constexpr int PAGE_SIZE = BUSTUB_PAGE_SIZE;                            // size of a data page in byte
+static constexpr int CACHELINE_SIZE = 64;                                     // size of a CPU cache line in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
+static constexpr int BUFFER_POOL_MAX_GROWTH = 4;                              // how far Resize can grow a pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int LRUK_REPLACER_K = 2;                                     // history length of LRU-K
+static constexpr int SCAN_RING_SIZE = 32;                                     // size of a scan's buffer ring
+static constexpr int PREFETCH_DEPTH = 8;                                      // pages a scan reads ahead
+static constexpr double BG_WRITER_CLEAN_FRACTION = 0.25;                      // frames the bg writer keeps clean
+static constexpr int FLUSH_BATCH_SIZE = 256;                                  // pages staged per flush batch
+static constexpr int EXTENT_SIZE = 8;                                         // pages a table heap reserves at once
+static constexpr int PREALLOCATE_PAGES = 256;                                 // pages a data file reserves at once
+
+// Pages are aligned to their size for direct I/O, so the size must be a power of two.
+static_assert(PAGE_SIZE >= 4096 && PAGE_SIZE <= 65536 && (PAGE_SIZE & (PAGE_SIZE - 1)) == 0,
+              "PAGE_SIZE must be a power of two from 4 KB to 64 KB");
 
-using frame_id_t = int32_t;    // frame id type
-using page_id_t = int32_t;     // page id type
-using txn_id_t = int32_t;      // transaction id type
-using lsn_t = int32_t;         // log sequence number type
-using slot_offset_t = size_t;  // slot offset type
+using frame_id_t = int32_t;        // frame id type
+using page_id_t = int32_t;         // page id type
+using txn_id_t = int32_t;          // transaction id type
+using lsn_t = int32_t;             // log sequence number type
+using slot_offset_t = size_t;      // slot offset type
+using tablespace_id_t = uint32_t;  // tablespace id type
 using oid_t = uint16_t;
 
 }  // namespace bustub
@@ -17,6 +17,15 @@
 
 namespace bustub {
 
+// Defined when compiling with ThreadSanitizer (gcc defines __SANITIZE_THREAD__, clang has the feature check).
+#if defined(__SANITIZE_THREAD__)
+#define BUSTUB_TSAN
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define BUSTUB_TSAN
+#endif
+#endif
+
 #define BUSTUB_ASSERT(expr, message) assert((expr) && (message))
 
 #define UNREACHABLE(message) throw std::logic_error(message)
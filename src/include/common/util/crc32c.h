@@ -0,0 +1,43 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.h
+//
+// Identification: src/include/common/util/crc32c.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * Crc32c computes CRC-32C (Castagnoli) checksums. On x86 with SSE4.2 and on ARMv8 with the CRC extension it uses the
+ * CPU's crc32c instructions, eight bytes at a time and in three interleaved streams for inputs of a page or more;
+ * elsewhere it falls back to a table-driven implementation.
+ */
+class Crc32c {
+ public:
+  /**
+   * Continues a checksum over more bytes.
+   * @param crc the checksum of the bytes before data, 0 to start a new checksum
+   * @param data the bytes to add
+   * @param length the number of bytes
+   * @return the checksum of the bytes before data followed by data
+   */
+  static uint32_t Extend(uint32_t crc, const char *data, size_t length);
+
+  /** @return the checksum of length bytes of data */
+  static uint32_t Value(const char *data, size_t length) { return Extend(0, data, length); }
+
+  /** @return true if the checksums are computed with CPU instructions */
+  static bool IsHardwareAccelerated();
+};
+
+}  // namespace bustub
@@ -0,0 +1,49 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_codec.h
+//
+// Identification: src/include/common/util/lz4_codec.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * Lz4Codec compresses and decompresses blocks in the LZ4 block format: a sequence of literal runs and back-references
+ * of at least four bytes within the last 64 KB. The compressor is a greedy single-pass matcher with a small hash
+ * table, which trades some ratio for speed, as LZ4's fast mode does. The decompressor checks every length and offset,
+ * so it can be fed untrusted bytes.
+ */
+class Lz4Codec {
+ public:
+  /**
+   * Compresses a block.
+   * @param src the bytes to compress
+   * @param length the number of bytes
+   * @param[out] dst the buffer for the compressed block
+   * @param capacity the size of dst
+   * @return the size of the compressed block, or 0 if it does not fit into capacity bytes
+   */
+  static size_t Compress(const char *src, size_t length, char *dst, size_t capacity);
+
+  /**
+   * Decompresses a block.
+   * @param src the compressed block
+   * @param length the size of the compressed block
+   * @param[out] dst the buffer for the decompressed bytes
+   * @param decompressed_length the number of bytes the block decompresses to
+   * @return false if the block is malformed or does not decompress to exactly decompressed_length bytes
+   */
+  static bool Decompress(const char *src, size_t length, char *dst, size_t decompressed_length);
+};
+
+}  // namespace bustub
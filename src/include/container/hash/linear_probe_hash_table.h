@@ -32,6 +32,10 @@ namespace bustub {
  * Implementation of linear probing hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table dynamically grows once full.
+ *
+ * The table is safe for concurrent use. Lookups, inserts and removes hold the table latch in read mode and latch the
+ * blocks they probe one at a time (lookups read them optimistically), so operations on different blocks run in
+ * parallel. Resize holds the table latch in write mode while it rebuilds the table.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator> {
@@ -87,6 +91,47 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
   size_t GetSize();
 
  private:
+  using BlockPage = HashTableBlockPage<KeyType, ValueType, KeyComparator>;
+
+  /**
+   * Inserts a key-value pair into a table, write-latching its blocks one at a time. The caller holds the table latch.
+   * @param block_page_ids the page ids of the blocks of the table
+   * @param block_size the number of slots used in each block
+   * @param key the key to create
+   * @param value the value to be associated with the key
+   * @param[out] inserted true if the pair was inserted, false if it is already in the table or a block could not be
+   * fetched
+   * @return false if every slot of the table is occupied, true otherwise
+   */
+  bool InsertIntoTable(const std::vector<page_id_t> &block_page_ids, size_t block_size, const KeyType &key,
+                       const ValueType &value, bool *inserted);
+
+  /**
+   * Creates the header page and the empty blocks of a table, deleting the pages again if one cannot be created.
+   * @param num_buckets the number of buckets of the table
+   * @param[out] header_page_id the page id of the header page
+   * @param[out] block_page_ids the page ids of the blocks, in order
+   * @return false if the buffer pool could not create every page
+   */
+  bool CreateTablePages(size_t num_buckets, page_id_t *header_page_id, std::vector<page_id_t> *block_page_ids);
+
+  /** Deletes the header page and the blocks of a table. */
+  void DeleteTablePages(page_id_t header_page_id, const std::vector<page_id_t> &block_page_ids);
+
+  /**
+   * @param num_buckets the number of buckets of a table
+   * @return the number of blocks the buckets are spread over
+   */
+  static size_t NumBlocksFor(size_t num_buckets) { return (num_buckets + BLOCK_ARRAY_SIZE - 1) / BLOCK_ARRAY_SIZE; }
+
+  /**
+   * @param num_buckets the number of buckets of a table
+   * @return the number of slots used in each block of the table
+   */
+  static size_t BlockSizeFor(size_t num_buckets) {
+    return (num_buckets + NumBlocksFor(num_buckets) - 1) / NumBlocksFor(num_buckets);
+  }
+
   // member variable
   page_id_t header_page_id_;
   BufferPoolManager *buffer_pool_manager_;
@@ -98,6 +143,10 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
   // Hash function
   HashFunction<KeyType> hash_fn_;
   size_t num_buckets_;
+
+  // The geometry of the table, a copy of the header page kept so that probes need not fetch it. Only Resize changes it.
+  std::vector<page_id_t> block_page_ids_;
+  size_t block_size_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,198 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.h
+//
+// Identification: src/include/storage/disk/async_disk_manager.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace bustub {
+
+/**
+ * AsyncDiskManager adds asynchronous page I/O to the DiskManager, so that callers can keep many reads and writes in
+ * flight at once. Requests are submitted to an io_uring, many per system call when they come in a batch, and a
+ * completion thread runs their callbacks. If the kernel does not offer io_uring (or forbids it), a pool of worker
+ * threads performs the requests with the synchronous calls instead. With direct I/O, worker threads also serve the
+ * reads into buffers that are not page-aligned, which the kernel would reject.
+ *
+ * The synchronous DiskManager interface keeps working alongside. Callbacks run on the completion or worker thread,
+ * never on the submitting one; they should be short and must not submit requests themselves. The buffers of a request
+ * must stay valid until its callback has run. Reads report failure to their callback if the page fails its checksum.
+ */
+class AsyncDiskManager : public DiskManager {
+ public:
+  /** Called when a request completes, with true on success. */
+  using IOCallback = std::function<void(bool success)>;
+
+  /** A page read or write. */
+  struct IORequest {
+    page_id_t page_id_;
+    /** The buffer to read into, or the page to write. */
+    char *page_data_;
+    bool is_write_;
+    IOCallback callback_;
+    /** The checksummed copy of the page that an io_uring write actually writes; set when the request is queued. */
+    std::unique_ptr<char, decltype(&free)> staged_{nullptr, &free};
+    /** The data file and offset of the page; set when the request is queued. */
+    int fd_{-1};
+    int64_t offset_{0};
+  };
+
+  /** Maximum number of requests in flight in the io_uring. */
+  static constexpr unsigned QUEUE_DEPTH = 128;
+  /** Number of worker threads used if io_uring is not available, or for unaligned reads with direct I/O. */
+  static constexpr size_t NUM_IO_WORKERS = 4;
+
+  /**
+   * Creates a new asynchronous disk manager.
+   * @param db_file the file name of the database file to write to
+   * @param io_mode how pages are read and written
+   * @param use_io_uring false to always use the worker threads, which COMPRESSED mode always does
+   */
+  explicit AsyncDiskManager(const std::string &db_file, DiskIOMode io_mode = DiskIOMode::BUFFERED,
+                            bool use_io_uring = true);
+
+  /** Waits for the requests in flight and stops the I/O threads. */
+  ~AsyncDiskManager() override;
+
+  /** Waits for the requests in flight, stops the I/O threads and closes the files. */
+  void ShutDown() override;
+
+  /**
+   * Reads a page asynchronously.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   * @param callback called when the read completes
+   */
+  void ReadPageAsync(page_id_t page_id, char *page_data, IOCallback callback);
+
+  /**
+   * Writes a page asynchronously. The page is not forced to disk; call SyncPages after it completes for that.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   * @param callback called when the write completes
+   */
+  void WritePageAsync(page_id_t page_id, const char *page_data, IOCallback callback);
+
+  /**
+   * Reads a page asynchronously.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   * @return a future that becomes ready with true on success when the read completes
+   */
+  std::future<bool> ReadPageAsync(page_id_t page_id, char *page_data);
+
+  /**
+   * Writes a page asynchronously.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   * @return a future that becomes ready with true on success when the write completes
+   */
+  std::future<bool> WritePageAsync(page_id_t page_id, const char *page_data);
+
+  /**
+   * Submits many requests at once. With io_uring they go to the kernel in as few system calls as the queue depth
+   * allows, and this blocks while QUEUE_DEPTH requests are in flight. If a request names a tablespace that is not open,
+   * this throws before any request of the batch is queued.
+   * @param requests the requests
+   */
+  void SubmitBatch(std::vector<IORequest> requests);
+
+  /** Waits until every request submitted so far has completed and its callback has run. */
+  void Drain();
+
+  /** @return true if requests go through io_uring, false if the worker threads perform them */
+  bool IsIOUringBacked() const { return ring_fd_ >= 0; }
+
+ private:
+  /**
+   * Sets up the io_uring and maps its rings.
+   * @return false if io_uring is not available
+   */
+  bool SetUpRing();
+
+  /** Unmaps and closes the io_uring. */
+  void TearDownRing();
+
+  /**
+   * Queues requests on the submission ring and submits them. Must be called with latch_ held.
+   * @param lock the held lock on latch_, released while waiting for room in the ring
+   * @param requests the requests; a nullptr entry submits a no-op that stops the completion thread
+   */
+  void SubmitToRing(std::unique_lock<std::mutex> *lock, std::vector<IORequest *> *requests);
+
+  /** Body of the completion thread: reaps completions from the io_uring and runs their callbacks. */
+  void RunCompletions();
+
+  /**
+   * Finishes a request completed by the io_uring and runs its callback.
+   * @param request the request
+   * @param result the number of bytes transferred, or a negative error number
+   */
+  void CompleteRequest(IORequest *request, int result);
+
+  /** Body of a worker thread: performs queued requests with the synchronous calls. */
+  void RunWorker();
+
+  /** Waits for the requests in flight and stops the I/O threads; does nothing on the second call. */
+  void StopIO();
+
+  /** io_uring descriptor, -1 if the worker threads are used. */
+  int ring_fd_{-1};
+  /** Mapped submission ring, completion ring and submission queue entries. */
+  void *sq_ring_{nullptr};
+  void *cq_ring_{nullptr};
+  io_uring_sqe *sqes_{nullptr};
+  size_t sq_ring_size_{0};
+  size_t cq_ring_size_{0};
+  size_t sqes_size_{0};
+  /** Fields of the rings shared with the kernel. */
+  unsigned *sq_tail_{nullptr};
+  unsigned *sq_mask_{nullptr};
+  unsigned *sq_array_{nullptr};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned *cq_mask_{nullptr};
+  io_uring_cqe *cqes_{nullptr};
+  /** Number of submission queue entries. */
+  unsigned sq_entries_{0};
+
+  /** Completion thread (io_uring) and worker threads (fallback, or unaligned reads with direct I/O). */
+  std::vector<std::thread> threads_;
+  /** Requests waiting for a worker thread. */
+  std::deque<IORequest *> worker_queue_;
+  /** True once the I/O threads have been told to exit. */
+  bool stopped_{false};
+  /** Requests submitted but not completed yet, including queued ones and those on the worker threads. */
+  size_t in_flight_{0};
+  /** Protects the submission ring, the worker queue, in_flight_ and stopped_. */
+  std::mutex latch_;
+  /** Signalled when requests complete. */
+  std::condition_variable completed_cv_;
+  /** Signalled when requests are queued for the workers, or the workers should exit. */
+  std::condition_variable worker_cv_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,159 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_page_store.h
+//
+// Identification: src/include/storage/disk/compressed_page_store.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rwlatch.h"
+
+namespace bustub {
+
+/**
+ * CompressedPageStore keeps compressed page images in variable-size slots of a file, for the DiskManager's COMPRESSED
+ * mode. The file is divided into units of SLOT_UNIT bytes; a slot is a run of units that starts with a SlotHeader
+ * naming the page it holds and checksumming the payload, followed by the LZ4-compressed page, or the raw page if it
+ * does not compress.
+ *
+ * Where each page lives is kept in an in-memory page-location map, which is rebuilt when the file is opened by reading
+ * the slot headers. A page that is rewritten always moves to a free slot, split off a larger one if need be, or to the
+ * end of the file. Its old slot is only marked free and reused after the store has been forced to disk, so that a
+ * crash, even of the machine, never destroys the only copy of a page. Every write carries a higher generation than the
+ * last, so if a crash leaves two slots for one page, the newer one wins unless its payload is damaged.
+ */
+class CompressedPageStore {
+ public:
+  /** Granularity of slots in the file. */
+  static constexpr size_t SLOT_UNIT = 256;
+
+  /**
+   * Opens or creates a page store.
+   * @param file_name the file name of the store
+   */
+  explicit CompressedPageStore(const std::string &file_name);
+
+  ~CompressedPageStore();
+
+  /**
+   * Compresses a page and writes it to a fresh slot, then frees the slot that held it before.
+   * @param page_id id of the page
+   * @param page_data raw page data, PAGE_SIZE bytes
+   * @return the number of bytes written to the file
+   */
+  size_t Write(page_id_t page_id, const char *page_data);
+
+  /**
+   * Reads and decompresses a page. A page that was never written reads as zeroes.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer of PAGE_SIZE bytes
+   * @param[out] bytes_read the number of bytes read from the file
+   * @return false if the page's slot is damaged
+   */
+  bool Read(page_id_t page_id, char *page_data, size_t *bytes_read);
+
+  /**
+   * Frees the slot of a page, which then reads as zeroes.
+   * @param page_id id of the page
+   */
+  void Remove(page_id_t page_id);
+
+  /** Forces the store to disk, and then frees the old slots of the pages rewritten since the last time. */
+  void Sync();
+
+  /** @return one past the highest page id ever written to the store, 0 if it is empty */
+  page_id_t GetPageIdLimit();
+
+  /** @return the number of bytes taken by the slots of stored pages */
+  size_t GetStoredBytes();
+
+ private:
+  /** Leads every slot. */
+  struct SlotHeader {
+    uint32_t magic_;
+    /** INVALID_PAGE_ID if the slot is free. */
+    page_id_t page_id_;
+    /** Length of the slot's payload, with RAW_FLAG set if the payload is the uncompressed page. */
+    uint32_t length_;
+    uint32_t generation_;
+    /** CRC-32C of the payload. */
+    uint32_t checksum_;
+  };
+
+  /** Where a page is stored. */
+  struct Location {
+    int64_t offset_;
+    uint32_t units_;
+    uint32_t generation_;
+  };
+
+  static constexpr uint32_t SLOT_MAGIC = 0x42545043;
+  static constexpr uint32_t RAW_FLAG = 1U << 31;
+  /** Number of units in the largest slot, which holds a raw page. */
+  static constexpr size_t MAX_SLOT_UNITS = (sizeof(SlotHeader) + PAGE_SIZE + SLOT_UNIT - 1) / SLOT_UNIT;
+
+  /** @return the number of units of a slot whose header has this length field, 0 if the length is invalid */
+  static uint32_t SlotUnits(uint32_t length);
+
+  /**
+   * Checks a slot read from the file and decodes its page.
+   * @param slot the slot, units * SLOT_UNIT bytes
+   * @param page_id id of the page the slot should hold
+   * @param units the size of the slot in units
+   * @param[out] page_data output buffer of PAGE_SIZE bytes, zeroed if the slot is damaged
+   * @return false if the slot is damaged
+   */
+  static bool DecodeSlot(const char *slot, page_id_t page_id, uint32_t units, char *page_data);
+
+  /** Rebuilds the page-location map and the free lists from the slot headers in the file. */
+  void Load();
+
+  /** Marks a slot free on disk and puts it on its free list; latch_ must be held in write mode. */
+  void FreeSlot(int64_t offset, uint32_t units);
+
+  /**
+   * Picks the slot for a page image: a free slot of the right size, else the front of a larger free slot whose rest
+   * stays free, else the end of the file. latch_ must be held in write mode.
+   * @param units the size of the image in units
+   * @return the offset of the slot
+   */
+  int64_t TakeSlot(uint32_t units);
+
+  /** Forces the store to disk and frees the slots in pending_slots_; latch_ must be held in write mode. */
+  void ReleasePendingSlots();
+
+  /** Writes count bytes at offset, retrying short writes. */
+  void WriteAt(int64_t offset, const char *data, size_t count);
+
+  /** Reads count bytes at offset, zero-filling past the end of the file. */
+  void ReadAt(int64_t offset, char *data, size_t count);
+
+  int fd_{-1};
+  // protects the fields below; readers hold it while they read a slot, so that it is not reused under them
+  ReaderWriterLatch latch_;
+  std::unordered_map<page_id_t, Location> locations_;
+  // offsets of free slots, in one list per size in units
+  std::vector<std::vector<int64_t>> free_slots_;
+  // old slots of rewritten pages, which stay as they are until the slots that replace them are on disk
+  std::vector<std::pair<page_id_t, Location>> pending_slots_;
+  // end of the last slot in the file
+  int64_t end_offset_{0};
+  uint32_t next_generation_{1};
+  page_id_t page_id_limit_{0};
+  size_t stored_bytes_{0};
+};
+
+}  // namespace bustub
@@ -12,33 +12,103 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <cstring>
 #include <fstream>
 #include <future>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "common/config.h"
+#include "storage/disk/compressed_page_store.h"
+#include "storage/page/page.h"
 
 namespace bustub {
 
+/** How the DiskManager does page I/O on the database file. */
+enum class DiskIOMode {
+  /** Page I/O goes through the operating system's page cache. */
+  BUFFERED,
+  /**
+   * Page I/O bypasses the page cache (O_DIRECT), so pages are only cached once, in the buffer pool. Buffers that are
+   * not page-aligned are copied through an aligned bounce buffer. Falls back to BUFFERED if the file system does not
+   * support direct I/O.
+   */
+  DIRECT,
+  /**
+   * The database file is opened read-only and mapped into memory, for read-only replicas. Pages are read from the
+   * mapping, which covers the file as it was when it was opened. Writes fail, and the log file is not opened.
+   */
+  MMAP_READ_ONLY,
+  /**
+   * Pages are compressed and kept in variable-size slots of a separate page store file, named like the database file
+   * with the extension .pages (see CompressedPageStore). Callers still read and write whole uncompressed pages. The
+   * database file only holds the free-space maps. Uses buffered I/O.
+   */
+  COMPRESSED
+};
+
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * Page I/O uses positional reads and writes (pread/pwrite) with 64-bit offsets on one file descriptor per data file, so
+ * any number of threads can read and write pages at once without sharing a file cursor.
+ *
+ * Which pages are allocated is tracked in free-space map pages stored in the database file itself: every PAGES_PER_MAP
+ * pages are preceded by a map page with one bit per page, so the file starts with the map of the first pages, followed
+ * by page HEADER_PAGE_ID. Map pages are not visible as page ids. Every allocation and deallocation writes the map page
+ * it changed before it returns, so the maps read back when the file is reopened are current even if the process
+ * crashed; SyncPages forces them to disk together with the pages.
+ *
+ * Every page written is stamped with a CRC-32C checksum at Page::OFFSET_CHECKSUM, computed on a private copy of the
+ * page so that it matches the bytes that reach the disk even if the caller's page changes during the write. Reads
+ * verify the checksum, which catches torn and corrupted pages; pages that are all zeroes were never written and pass.
+ * In COMPRESSED mode the checksum is stamped before the page is compressed and verified after it is decompressed.
+ *
+ * Pages can be spread over several data files. Page ids below MAIN_TABLESPACE_PAGES belong to the database file, which
+ * can thus grow to 2^30 pages. Above it, every PAGES_PER_TABLESPACE page ids (2^24) form one of the other tablespaces,
+ * up to MAX_TABLESPACES in all. Each tablespace has a data file of its own, laid out like the database file with
+ * free-space maps of its own. The database file is tablespace MAIN_TABLESPACE; others are opened with OpenTablespace,
+ * so that for example a hot index can live on a faster device than a cold table, and dropped with DropTablespace,
+ * which unlinks their file. Each data file reserves disk space PREALLOCATE_PAGES pages at a time with fallocate as it
+ * grows. Tablespaces other than the main one are not available in MMAP_READ_ONLY and COMPRESSED modes.
  */
 class DiskManager {
  public:
+  /** Number of pages tracked by one free-space map page, one bit each. */
+  static constexpr size_t PAGES_PER_MAP = PAGE_SIZE * 8;
+  /** Number of page ids of the database file, which come first. */
+  static constexpr size_t MAIN_TABLESPACE_PAGES = size_t{1} << 30;
+  /** Page ids past the database file's hold their tablespace in the bits from TABLESPACE_SHIFT up. */
+  static constexpr int TABLESPACE_SHIFT = 24;
+  /** Number of page ids in a tablespace other than the main one. */
+  static constexpr size_t PAGES_PER_TABLESPACE = size_t{1} << TABLESPACE_SHIFT;
+  /** Number of tablespaces, so that every page id and the one past it are non-negative. */
+  static constexpr tablespace_id_t MAX_TABLESPACES = MAIN_TABLESPACE_PAGES / PAGES_PER_TABLESPACE;
+  /** The tablespace of the database file. */
+  static constexpr tablespace_id_t MAIN_TABLESPACE = 0;
+  static_assert(MAIN_TABLESPACE_PAGES + (MAX_TABLESPACES - 1) * PAGES_PER_TABLESPACE < INT32_MAX,
+                "Every page id must be non-negative.");
+  static_assert(PAGES_PER_TABLESPACE % PAGES_PER_MAP == 0, "A free-space map interval must not span tablespaces.");
+
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param io_mode how pages are read and written
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, DiskIOMode io_mode = DiskIOMode::BUFFERED);
 
-  ~DiskManager() = default;
+  virtual ~DiskManager();
 
   /**
    * Shut down the disk manager and close all the file resources.
    */
-  void ShutDown();
+  virtual void ShutDown();
 
   /**
    * Write a page to the database file.
@@ -48,11 +118,27 @@ class DiskManager {
   void WritePage(page_id_t page_id, const char *page_data);
 
   /**
-   * Read a page from the database file.
+   * Write a run of consecutive pages to the database file with as few writes as possible.
+   * The pages are not forced to disk; call SyncPages for that.
+   * @param first_page_id id of the first page of the run
+   * @param pages raw data of the pages, in page id order
+   * @param num_pages number of pages in the run
+   */
+  void WritePages(page_id_t first_page_id, const char *const *pages, size_t num_pages);
+
+  /**
+   * Force every page written so far to disk, together with the free-space maps.
+   */
+  void SyncPages();
+
+  /**
+   * Read a page from the database file and verify its checksum. The part of the page past the end of the file reads
+   * as zeroes.
    * @param page_id id of the page
-   * @param[out] page_data output buffer
+   * @param[out] page_data output buffer, which holds the page as read even if its checksum does not match
+   * @return false if the page failed its checksum
    */
-  void ReadPage(page_id_t page_id, char *page_data);
+  bool ReadPage(page_id_t page_id, char *page_data);
 
   /**
    * Flush the entire log buffer into disk.
@@ -71,17 +157,90 @@ class DiskManager {
   bool ReadLog(char *log_data, int size, int offset);
 
   /**
-   * Allocate a page on disk.
-   * @return the id of the allocated page
+   * Allocate a page on disk. Pages freed by DeallocatePage are reused before the file grows.
+   * @return the id of the allocated page, INVALID_PAGE_ID if the database file is full
    */
-  page_id_t AllocatePage();
+  page_id_t AllocatePage() { return AllocatePage(1, 0); }
 
   /**
-   * Deallocate a page on disk.
+   * Allocate a page on disk whose id is congruent to residue modulo modulus, for buffer pool shards that own every
+   * modulus-th page id. Pages skipped over to find such an id stay free for the other residues. Freed pages are reused
+   * in constant time; the first allocation with a modulus builds its free lists from the free-space maps.
+   * @param modulus the number of residue classes
+   * @param residue the residue of the page id, less than modulus
+   * @param tablespace the tablespace to allocate the page in, which must be open
+   * @return the id of the allocated page, INVALID_PAGE_ID if the tablespace is full
+   */
+  page_id_t AllocatePage(uint32_t modulus, uint32_t residue, tablespace_id_t tablespace = MAIN_TABLESPACE);
+
+  /**
+   * Allocate a run of pages with consecutive ids, which are also contiguous in the data file. Extents are always
+   * taken from the end of the file.
+   * @param num_pages the number of pages, in [1, PAGES_PER_MAP]
+   * @param tablespace the tablespace to allocate the pages in, which must be open
+   * @return the id of the first page of the run, INVALID_PAGE_ID if the tablespace has no room for it
+   */
+  page_id_t AllocateExtent(size_t num_pages, tablespace_id_t tablespace = MAIN_TABLESPACE);
+
+  /**
+   * Deallocate a page on disk. Its id is handed out again by a later allocation.
    * @param page_id id of the page to deallocate
    */
   void DeallocatePage(page_id_t page_id);
 
+  /**
+   * @param page_id id of a page
+   * @return true if the page is allocated
+   */
+  bool IsAllocated(page_id_t page_id);
+
+  /**
+   * Opens the data file of a tablespace, creating it if it does not exist yet. The file is named like the database
+   * file, with the tablespace id before the extension (tablespace 3 of test.db is test.3.db).
+   * @param tablespace the tablespace, in [1, MAX_TABLESPACES); it must not be open already
+   * @param directory the directory of the data file, the directory of the database file if empty
+   * @return the name of the data file
+   */
+  std::string OpenTablespace(tablespace_id_t tablespace, const std::string &directory = "");
+
+  /**
+   * Closes the data file of a tablespace and unlinks it, which frees all of its pages at once. No page of the
+   * tablespace may be read or written afterwards, so its pages must have been deleted from the buffer pool.
+   * @param tablespace an open tablespace other than MAIN_TABLESPACE
+   */
+  void DropTablespace(tablespace_id_t tablespace);
+
+  /** @return true if tablespaces other than the main one can be opened, which needs buffered or direct I/O */
+  bool SupportsTablespaces() const {
+    return io_mode_ == DiskIOMode::BUFFERED || io_mode_ == DiskIOMode::DIRECT;
+  }
+
+  /** @return true if the tablespace is open */
+  bool HasTablespace(tablespace_id_t tablespace) const {
+    return tablespace < MAX_TABLESPACES && files_[tablespace] != nullptr;
+  }
+
+  /** @return the tablespace that a page belongs to */
+  static tablespace_id_t GetTablespace(page_id_t page_id) {
+    auto id = static_cast<size_t>(page_id);
+    if (id < MAIN_TABLESPACE_PAGES) {
+      return MAIN_TABLESPACE;
+    }
+    return static_cast<tablespace_id_t>(1 + ((id - MAIN_TABLESPACE_PAGES) >> TABLESPACE_SHIFT));
+  }
+
+  /** @return the lowest page id of a tablespace */
+  static page_id_t GetFirstPageId(tablespace_id_t tablespace) {
+    return tablespace == MAIN_TABLESPACE
+               ? 0
+               : static_cast<page_id_t>(MAIN_TABLESPACE_PAGES + (size_t{tablespace - 1} << TABLESPACE_SHIFT));
+  }
+
+  /** @return the number of page ids of a tablespace */
+  static size_t GetTablespacePages(tablespace_id_t tablespace) {
+    return tablespace == MAIN_TABLESPACE ? MAIN_TABLESPACE_PAGES : PAGES_PER_TABLESPACE;
+  }
+
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
 
@@ -91,6 +250,71 @@ class DiskManager {
   /** @return the number of disk writes */
   int GetNumWrites() const;
 
+  /** @return the number of page reads, which may be issued by the buffer pool's background I/O thread */
+  int GetNumReads() const;
+
+  /** @return the number of bytes transferred from disk by page reads, which is less than a page each when compressed */
+  int64_t GetPageBytesRead() const { return page_bytes_read_; }
+
+  /** @return the number of bytes transferred to disk by page writes */
+  int64_t GetPageBytesWritten() const { return page_bytes_written_; }
+
+  /** @return the number of pages read whose checksum did not match their contents */
+  int GetNumChecksumFailures() const { return num_checksum_failures_; }
+
+  /**
+   * Computes the checksum of a page: the CRC-32C of the page without its checksum field, seeded with the page id so
+   * that a page written to the wrong place does not verify either.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   * @return the checksum
+   */
+  static uint32_t ComputeChecksum(page_id_t page_id, const char *page_data);
+
+  /** Stores the checksum of a page in its checksum field. */
+  static void StampChecksum(page_id_t page_id, char *page_data) {
+    uint32_t checksum = ComputeChecksum(page_id, page_data);
+    memcpy(page_data + Page::OFFSET_CHECKSUM, &checksum, sizeof(checksum));
+  }
+
+  /**
+   * @param page_id id of the page
+   * @param page_data raw page data
+   * @return true if the page's checksum field matches its contents, or the page is all zeroes
+   */
+  static bool VerifyChecksum(page_id_t page_id, const char *page_data);
+
+  /** @return true if page I/O bypasses the operating system's page cache */
+  bool IsDirectIO() const { return direct_io_; }
+
+  /** @return true if pages are compressed into a page store */
+  bool IsCompressed() const { return page_store_ != nullptr; }
+
+  /** @return true if the database file is mapped read-only into memory */
+  bool IsMemoryMapped() const { return mapping_ != nullptr; }
+
+  /** @return the number of page ids covered by the mapping of the database file, 0 if it is not mapped */
+  size_t GetMappedPageCount() const { return mapped_pages_; }
+
+  /**
+   * @param page_id id of a page
+   * @return the page's bytes in the read-only mapping of the database file, nullptr if the page is not mapped
+   */
+  const char *GetMappedPage(page_id_t page_id) const {
+    if (page_id < 0 || static_cast<size_t>(page_id) >= mapped_pages_) {
+      return nullptr;
+    }
+    return mapping_ + PageOffset(page_id);
+  }
+
+  /**
+   * Tells the kernel that a run of consecutive mapped pages is about to be scanned, so that it reads them ahead and
+   * drops them early. Does nothing if the file is not mapped.
+   * @param first_page_id id of the first page of the run
+   * @param num_pages number of pages in the run
+   */
+  void AdviseSequential(page_id_t first_page_id, size_t num_pages);
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -100,17 +324,158 @@ class DiskManager {
   /** Checks if the non-blocking flush future was set. */
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
+ protected:
+  /**
+   * @param page_id id of a page
+   * @return the offset of the page in the data file of its tablespace, which accounts for the free-space map pages
+   * before it
+   */
+  static int64_t PageOffset(page_id_t page_id) {
+    auto page_no = static_cast<int64_t>(page_id - GetFirstPageId(GetTablespace(page_id)));
+    auto map_count = page_no / static_cast<int64_t>(PAGES_PER_MAP) + 1;
+    return (page_no + map_count) * PAGE_SIZE;
+  }
+
+  /**
+   * @param page_id id of a page
+   * @return the descriptor of the data file that holds the page; throws if its tablespace is not open
+   */
+  int FileDescriptor(page_id_t page_id) const;
+
+  /** The data file of a tablespace and its page allocation state. */
+  /** The free lists of a data file for one modulus. */
+  struct FreeLists {
+    // one list per residue
+    std::vector<std::vector<page_id_t>> lists_;
+    // number of entries over all lists, including pages allocated since they were put on a list
+    size_t entries_{0};
+  };
+
+  struct DataFile {
+    std::string file_name_;
+    // descriptor for all page I/O; opened with O_DIRECT in direct I/O mode
+    int fd_{-1};
+    page_id_t first_page_id_{0};
+    // protects the page allocation state below
+    std::mutex alloc_latch_;
+    // one past the highest page id ever allocated; pages below it that are not allocated are on a free list
+    page_id_t next_page_id_{0};
+    // free-space maps, one bit per page (set if allocated), and whether they changed since they were last written
+    std::vector<std::unique_ptr<char[]>> free_space_maps_;
+    std::vector<bool> map_dirty_;
+    // free page ids below next_page_id_, in one list per residue for every modulus allocated with lately. A page
+    // allocated through one modulus stays in the lists of the others, which skip it when they come across it.
+    std::unordered_map<uint32_t, FreeLists> free_pages_;
+    // bytes at the start of the file that are known to have disk space reserved
+    int64_t preallocated_bytes_{0};
+  };
+
+  // data files by tablespace, nullptr where a tablespace is not open; files_[MAIN_TABLESPACE] is the database file
+  std::array<std::unique_ptr<DataFile>, MAX_TABLESPACES> files_;
+  // true if the data files bypass the page cache
+  bool direct_io_{false};
+  // read-only mapping of the whole db file in MMAP_READ_ONLY mode, and its length in bytes and in page ids
+  char *mapping_{nullptr};
+  size_t mapping_size_{0};
+  size_t mapped_pages_{0};
+  std::atomic<int> num_writes_{0};
+  std::atomic<int> num_reads_{0};
+  std::atomic<int> num_checksum_failures_{0};
+  std::atomic<int64_t> page_bytes_read_{0};
+  std::atomic<int64_t> page_bytes_written_{0};
+  // compressed page images in COMPRESSED mode, nullptr otherwise
+  std::unique_ptr<CompressedPageStore> page_store_;
+
+  /**
+   * Verifies the checksum of a page that was just read, and counts and logs a mismatch.
+   * @return false if the page failed its checksum
+   */
+  bool CheckReadPage(page_id_t page_id, const char *page_data);
+
+  /**
+   * Copies pages into a thread-local, page-aligned staging buffer and stamps their checksums there.
+   * @param first_page_id id of the first page
+   * @param pages raw data of the pages, in page id order
+   * @param num_pages number of pages, at most STAGING_PAGES
+   * @return the staged copies, one after the other
+   */
+  static char *StagePages(page_id_t first_page_id, const char *const *pages, size_t num_pages);
+
+  /** Number of pages that StagePages can hold, and thus the most pages a single write transfers. */
+  static constexpr size_t STAGING_PAGES = 32;
+
  private:
-  int GetFileSize(const std::string &file_name);
+  int64_t GetFileSize(const std::string &file_name);
+
+  /**
+   * Reads or writes pages with pread/pwrite on a data file. Retries short transfers, zero-fills reads past the end of
+   * the file, and in direct I/O mode copies a single page through an aligned buffer if page_data is not page-aligned.
+   * @param fd descriptor of the data file
+   * @param offset offset of the first page in the data file
+   * @param page_data the pages to write, or the buffer to read into
+   * @param is_write true to write the pages, false to read them
+   * @param length number of bytes, a multiple of PAGE_SIZE; longer transfers must be page-aligned in direct I/O mode
+   */
+  void PageIO(int fd, int64_t offset, char *page_data, bool is_write, size_t length = PAGE_SIZE);
+
+  /**
+   * Writes a run of consecutive pages that does not cross a free-space map page, STAGING_PAGES pages per pwrite.
+   */
+  void WriteRun(page_id_t first_page_id, const char *const *pages, size_t num_pages);
+
+  /**
+   * Opens the database file read-only and maps it into memory, for MMAP_READ_ONLY mode.
+   * @param db_file the file name of the database file
+   */
+  void MapFile(const std::string &db_file);
+
+  /**
+   * Opens a data file, creating it if need be.
+   * @param file_name the name of the data file
+   * @param[in,out] direct_io whether to try direct I/O; set to whether the file was opened for direct I/O
+   * @return the descriptor of the file, -1 on failure
+   */
+  int OpenDataFile(const std::string &file_name, bool *direct_io);
+
+  /** @return the data file of an open tablespace; throws if it is not open */
+  DataFile *GetDataFile(tablespace_id_t tablespace) const;
+
+  /** Reads the free-space maps of an existing file and rebuilds next_page_id_ from them. */
+  void LoadFreeSpaceMaps(DataFile *file);
+
+  /** Writes the free-space maps of a file that changed since they were last written; alloc_latch_ must be held. */
+  void WriteFreeSpaceMaps(DataFile *file);
+
+  /** Reserves disk space up to PREALLOCATE_PAGES pages past the file's next page id; alloc_latch_ must be held. */
+  void Preallocate(DataFile *file);
+
+  /** @return true if the page is marked allocated in its free-space map; alloc_latch_ must be held */
+  static bool TestAllocated(const DataFile &file, page_id_t page_id);
+
+  /** Marks a page allocated or free in its free-space map; alloc_latch_ must be held. */
+  static void SetAllocated(DataFile *file, page_id_t page_id, bool allocated);
+
+  /**
+   * @return the free lists of a file for a modulus, built from the free-space maps on first use; alloc_latch_ must be
+   * held
+   */
+  static FreeLists &GetFreeLists(DataFile *file, uint32_t modulus);
+
+  /**
+   * Puts a free page on the free lists of every modulus. The lists of a modulus that has gathered more entries than
+   * there are pages, most of them for pages allocated through other moduli, are dropped; they are built again from the
+   * free-space maps if the modulus is used again. alloc_latch_ must be held.
+   */
+  static void AddFreePage(DataFile *file, page_id_t page_id);
+
+  DiskIOMode io_mode_;
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
   std::string file_name_;
-  std::atomic<page_id_t> next_page_id_;
+  // serializes opening and dropping tablespaces
+  std::mutex tablespace_latch_;
   int num_flushes_;
-  int num_writes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
 };
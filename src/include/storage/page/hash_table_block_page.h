@@ -18,6 +18,7 @@
 
 #include "common/config.h"
 #include "storage/index/int_comparator.h"
+#include "storage/page/page.h"
 #include "storage/page/hash_table_page_defs.h"
 
 namespace bustub {
@@ -26,9 +27,9 @@ namespace bustub {
  * non-unique keys.
  *
  * Block page format (keys are stored in order):
- *  ----------------------------------------------------------------
- * | KEY(1) + VALUE(1) | KEY(2) + VALUE(2) | ... | KEY(n) + VALUE(n)
- *  ----------------------------------------------------------------
+ *  -------------------------------------------------------------------------------------------------
+ * | PAGE HEADER | OCCUPIED | READABLE | KEY(1) + VALUE(1) | KEY(2) + VALUE(2) | ... | KEY(n) + VALUE(n)
+ *  -------------------------------------------------------------------------------------------------
  *
  *  Here '+' means concatenation.
  *
@@ -57,9 +58,9 @@ class HashTableBlockPage {
 
   /**
    * Attempts to insert a key and value into an index in the block.
-   * The insert is thread safe. It uses compare and swap to claim the index,
-   * and then writes the key and value into the index, and then marks the
-   * index as readable.
+   * The caller holds the write latch of the block. The key and value are
+   * written before the index is marked as occupied and readable, so that
+   * optimistic readers never see a flagged index without its pair.
    *
    * @param bucket_ind index to write the key and value to
    * @param key key to insert
@@ -93,11 +94,46 @@ class HashTableBlockPage {
    */
   bool IsReadable(slot_offset_t bucket_ind) const;
 
+  /**
+   * Finds the first index in [from, end) that is not occupied. The occupied bitmap is scanned a 64-bit word at a time,
+   * so a run of occupied indexes is skipped in a few steps.
+   *
+   * @param from the first index to look at
+   * @param end one past the last index to look at
+   * @return the first unoccupied index, or end if every index in the range is occupied
+   */
+  slot_offset_t NextUnoccupied(slot_offset_t from, slot_offset_t end) const;
+
+  /**
+   * Finds the first index in [from, end) that is readable, scanning the readable bitmap a 64-bit word at a time.
+   *
+   * @param from the first index to look at
+   * @param end one past the last index to look at
+   * @return the first readable index, or end if no index in the range is readable
+   */
+  slot_offset_t NextReadable(slot_offset_t from, slot_offset_t end) const;
+
  private:
-  std::atomic_char occupied_[(BLOCK_ARRAY_SIZE - 1) / 8 + 1];
+  static constexpr size_t BITMAP_SIZE = (BLOCK_ARRAY_SIZE - 1) / 8 + 1;
+
+  /**
+   * Loads the bits of a bitmap that start at an index into a word, the bit of the index being the lowest one. At least
+   * the 57 lowest bits are loaded; the bits above them and past the end of the bitmap are zero.
+   *
+   * @param bitmap the bitmap to load from
+   * @param from the index of the first bit
+   * @param[out] num_bits the number of bits loaded
+   * @return the loaded bits
+   */
+  static uint64_t LoadBits(const std::atomic_char *bitmap, slot_offset_t from, size_t *num_bits);
+
+  // the common page header (page id, LSN and checksum), which is not used by the block page itself
+  char page_header_[Page::SIZE_PAGE_HEADER];
+  // One bit per index: 1 if the index has ever held a pair (pair or tombstone), 0 if brand new.
+  std::atomic_char occupied_[BITMAP_SIZE];
 
-  // 0 if tombstone/brand new (never occupied), 1 otherwise.
-  std::atomic_char readable_[(BLOCK_ARRAY_SIZE - 1) / 8 + 1];
+  // One bit per index: 0 if tombstone/brand new (never occupied), 1 otherwise.
+  std::atomic_char readable_[BITMAP_SIZE];
   MappingType array_[0];
 };
 
@@ -26,13 +26,16 @@ namespace bustub {
  *
  * Header Page for linear probing hash table.
  *
- * Header format (size in byte, 16 bytes in total):
- * -------------------------------------------------------------
- * | LSN (4) | Size (4) | PageId(4) | NextBlockIndex(4)
- * -------------------------------------------------------------
+ * Header format (size in byte, 32 bytes in total), starting with the common page header:
+ * ----------------------------------------------------------------------------------
+ * | PageId (4) | LSN (4) | Checksum (4) | (4) | Size (8) | NextBlockIndex (8)
+ * ----------------------------------------------------------------------------------
  */
 class HashTableHeaderPage {
  public:
+  /** The most block page ids that fit into a header page after its fields. */
+  static constexpr size_t MAX_NUM_BLOCKS = (PAGE_SIZE - 32) / sizeof(page_id_t);
+
   /**
    * @return the number of buckets in the hash table;
    */
@@ -82,17 +85,19 @@ class HashTableHeaderPage {
    * @param index the index of the block
    * @return the page_id for the block.
    */
-  page_id_t GetBlockPageId(size_t index);
+  page_id_t GetBlockPageId(size_t index) const;
 
   /**
    * @return the number of blocks currently stored in the header page
    */
-  size_t NumBlocks();
+  size_t NumBlocks() const;
 
  private:
+  __attribute__((unused)) page_id_t page_id_;
   __attribute__((unused)) lsn_t lsn_;
+  // maintained by the DiskManager
+  __attribute__((unused)) uint32_t checksum_;
   __attribute__((unused)) size_t size_;
-  __attribute__((unused)) page_id_t page_id_;
   __attribute__((unused)) size_t next_ind_=0;
   __attribute__((unused)) page_id_t block_page_ids_[0];
 };
@@ -12,10 +12,14 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <thread>  // NOLINT
 
 #include "common/config.h"
+#include "common/macros.h"
 #include "common/rwlatch.h"
 
 namespace bustub {
@@ -24,14 +28,24 @@ namespace bustub {
  * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
  * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
  * pin count, dirty flag, page id, etc.
+ *
+ * Besides the latch, every page carries a version word in the style of a seqlock: it is odd while a writer holds the
+ * write latch and is bumped on every write latch and unlatch. Readers that hold a pin can read the page without
+ * touching the latch by recording the version, reading, and checking that the version did not change (OptimisticRead).
+ *
+ * The bytes of a page live outside the Page object: buffer pool frames point into the pool's FrameArena (or, for a
+ * MmapBufferPoolManager, into the read-only mapping of the database file), while pages created on their own allocate
+ * their data. Page objects are cache-line aligned, so that the latches and pin counts of
+ * neighbouring frames never share a cache line.
  */
-class Page {
+class alignas(CACHELINE_SIZE) Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManager;
+  friend class MmapBufferPoolManager;
 
  public:
-  /** Constructor. Zeros out the page data. */
-  Page() { ResetMemory(); }
+  /** Constructor. Allocates zeroed page data owned by this page. */
+  Page() : data_(new char[PAGE_SIZE]), owned_data_(data_) { ResetMemory(); }
 
   /** Default destructor. */
   ~Page() = default;
@@ -49,10 +63,20 @@ class Page {
   inline bool IsDirty() { return is_dirty_; }
 
   /** Acquire the page write latch. */
-  inline void WLatch() { rwlatch_.WLock(); }
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.fetch_add(1, std::memory_order_relaxed);
+#ifndef BUSTUB_TSAN
+    // Keep the writes made under the latch from becoming visible before the version turned odd.
+    std::atomic_thread_fence(std::memory_order_release);
+#endif
+  }
 
   /** Release the page write latch. */
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
+  inline void WUnlatch() {
+    version_.fetch_add(1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
 
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
@@ -60,34 +84,82 @@ class Page {
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
+  /**
+   * Reads the page optimistically, without taking the latch. read_fn is run against the page and its result is
+   * returned if no writer latched the page in the meantime; otherwise read_fn is retried a few times and finally run
+   * under the read latch. The caller must hold a pin on the page.
+   *
+   * Since read_fn may observe a page in the middle of a write, it must not trust anything it reads: offsets and sizes
+   * read from the page have to be checked before they are followed, and read_fn must not have side effects.
+   * @param read_fn the read to perform; must return a value
+   * @return the result of a read_fn run that saw a consistent page
+   */
+  template <typename ReadFn>
+  auto OptimisticRead(ReadFn &&read_fn) -> decltype(read_fn()) {
+#ifndef BUSTUB_TSAN
+    // ThreadSanitizer cannot tell a validated optimistic read from a data race, so sanitized builds always latch.
+    for (int attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt) {
+      uint64_t version = version_.load(std::memory_order_acquire);
+      if ((version & 1) == 0) {
+        auto result = read_fn();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version_.load(std::memory_order_relaxed) == version) {
+          return result;
+        }
+      }
+      std::this_thread::yield();
+    }
+#endif
+    RLatch();
+    auto result = read_fn();
+    RUnlatch();
+    return result;
+  }
+
   /** @return the page LSN. */
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
 
   /** Sets the page LSN. */
   inline void SetLSN(lsn_t lsn) { memcpy(GetData() + OFFSET_LSN, &lsn, sizeof(lsn_t)); }
 
- protected:
   static_assert(sizeof(page_id_t) == 4);
   static_assert(sizeof(lsn_t) == 4);
 
-  static constexpr size_t SIZE_PAGE_HEADER = 8;
+  /** Every page format starts with this header: | PageId (4) | LSN (4) | Checksum (4) |. */
+  static constexpr size_t SIZE_PAGE_HEADER = 12;
   static constexpr size_t OFFSET_PAGE_START = 0;
   static constexpr size_t OFFSET_LSN = 4;
+  /** The checksum is stamped by the DiskManager when the page is written and verified when it is read back. */
+  static constexpr size_t OFFSET_CHECKSUM = 8;
+
+ protected:
+  /** Number of optimistic attempts OptimisticRead makes before it falls back to the read latch. */
+  static constexpr int OPTIMISTIC_READ_ATTEMPTS = 4;
 
  private:
+  /**
+   * Creates a page on top of a buffer pool frame.
+   * @param data the PAGE_SIZE bytes of the frame, which must already be zeroed (or hold the page, for a mapped page)
+   */
+  explicit Page(char *data) : data_(data) {}
+
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
 
   /** The actual data that is stored within a page. */
-  char data_[PAGE_SIZE]{};
-  /** The ID of this page. */
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
+  char *data_;
+  /** The ID of this page. Atomic because the buffer pool reads it without its latch when pinning a page it found. */
+  std::atomic<page_id_t> page_id_ = INVALID_PAGE_ID;
+  /** The pin count of this page, or -1 while the buffer pool reassigns the frame. */
+  std::atomic<int> pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
+  /** Seqlock version: odd while the page is write-latched. */
+  std::atomic<uint64_t> version_{0};
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
+  /** Data allocated by a page that is not part of a buffer pool, nullptr otherwise. */
+  std::unique_ptr<char[]> owned_data_;
 };
 
 }  // namespace bustub
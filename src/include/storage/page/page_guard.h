@@ -0,0 +1,225 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard.h
+//
+// Identification: src/include/storage/page/page_guard.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+class ReadPageGuard;
+class WritePageGuard;
+
+/**
+ * BasicPageGuard owns one pin on a buffer pool page and unpins it when it is destroyed or dropped. The guard remembers
+ * whether the page was modified through it and passes that on as the dirty flag of the unpin.
+ *
+ * Guards are move-only: moving a guard transfers the pin, and the moved-from guard becomes empty.
+ */
+class BasicPageGuard {
+ public:
+  /** Creates an empty guard. */
+  BasicPageGuard() = default;
+
+  /**
+   * Creates a guard for a page that is already pinned.
+   * @param bpm the buffer pool manager that holds the page
+   * @param page the pinned page, or nullptr for an empty guard
+   */
+  BasicPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+
+  DISALLOW_COPY(BasicPageGuard);
+
+  BasicPageGuard(BasicPageGuard &&that) noexcept;
+
+  /** Drops the page held by this guard, then takes over the page of that. */
+  BasicPageGuard &operator=(BasicPageGuard &&that) noexcept;
+
+  ~BasicPageGuard() { Drop(); }
+
+  /** Unpins the page, if any. The guard is empty afterwards. */
+  void Drop();
+
+  /**
+   * Latches the page for reading and moves the pin into a ReadPageGuard. This guard is empty afterwards.
+   * @return the read guard
+   */
+  ReadPageGuard UpgradeRead();
+
+  /**
+   * Latches the page for writing and moves the pin into a WritePageGuard. This guard is empty afterwards.
+   * @return the write guard
+   */
+  WritePageGuard UpgradeWrite();
+
+  /** @return true if the guard holds a page, false if it is empty (e.g. because the fetch failed) */
+  bool IsValid() const { return page_ != nullptr; }
+
+  /** @return the id of the guarded page */
+  page_id_t PageId() { return page_->GetPageId(); }
+
+  /** @return the guarded page, for page types that derive from Page */
+  Page *GetPage() { return page_; }
+
+  /** @return the data of the guarded page */
+  const char *GetData() { return page_->GetData(); }
+
+  /** @return the data of the guarded page, reinterpreted as T */
+  template <class T>
+  const T *As() {
+    return reinterpret_cast<const T *>(GetData());
+  }
+
+  /** @return the data of the guarded page for modification; the page is unpinned dirty */
+  char *GetDataMut() {
+    is_dirty_ = true;
+    return page_->GetData();
+  }
+
+  /** @return the data of the guarded page for modification, reinterpreted as T; the page is unpinned dirty */
+  template <class T>
+  T *AsMut() {
+    return reinterpret_cast<T *>(GetDataMut());
+  }
+
+  /** Marks the page dirty, for pages that were modified through GetPage. */
+  void SetDirty() { is_dirty_ = true; }
+
+ private:
+  friend class ReadPageGuard;
+  friend class WritePageGuard;
+
+  BufferPoolManager *bpm_{nullptr};
+  Page *page_{nullptr};
+  bool is_dirty_{false};
+};
+
+/**
+ * ReadPageGuard owns one pin and the read latch of a buffer pool page, and releases both when it is destroyed or
+ * dropped (the latch first).
+ */
+class ReadPageGuard {
+ public:
+  /** Creates an empty guard. */
+  ReadPageGuard() = default;
+
+  /**
+   * Creates a guard for a page that is already pinned and read-latched.
+   * @param bpm the buffer pool manager that holds the page
+   * @param page the pinned and latched page, or nullptr for an empty guard
+   */
+  ReadPageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+
+  DISALLOW_COPY(ReadPageGuard);
+
+  ReadPageGuard(ReadPageGuard &&that) noexcept = default;
+
+  /** Drops the page held by this guard, then takes over the page of that. */
+  ReadPageGuard &operator=(ReadPageGuard &&that) noexcept;
+
+  ~ReadPageGuard() { Drop(); }
+
+  /** Unlatches and unpins the page, if any. The guard is empty afterwards. */
+  void Drop();
+
+  /** @return true if the guard holds a page, false if it is empty (e.g. because the fetch failed) */
+  bool IsValid() const { return guard_.IsValid(); }
+
+  /** @return the id of the guarded page */
+  page_id_t PageId() { return guard_.PageId(); }
+
+  /** @return the guarded page, for page types that derive from Page */
+  Page *GetPage() { return guard_.GetPage(); }
+
+  /** @return the data of the guarded page */
+  const char *GetData() { return guard_.GetData(); }
+
+  /** @return the data of the guarded page, reinterpreted as T */
+  template <class T>
+  const T *As() {
+    return guard_.As<T>();
+  }
+
+ private:
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
+};
+
+/**
+ * WritePageGuard owns one pin and the write latch of a buffer pool page, and releases both when it is destroyed or
+ * dropped (the latch first).
+ */
+class WritePageGuard {
+ public:
+  /** Creates an empty guard. */
+  WritePageGuard() = default;
+
+  /**
+   * Creates a guard for a page that is already pinned and write-latched.
+   * @param bpm the buffer pool manager that holds the page
+   * @param page the pinned and latched page, or nullptr for an empty guard
+   */
+  WritePageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+
+  DISALLOW_COPY(WritePageGuard);
+
+  WritePageGuard(WritePageGuard &&that) noexcept = default;
+
+  /** Drops the page held by this guard, then takes over the page of that. */
+  WritePageGuard &operator=(WritePageGuard &&that) noexcept;
+
+  ~WritePageGuard() { Drop(); }
+
+  /** Unlatches and unpins the page, if any. The guard is empty afterwards. */
+  void Drop();
+
+  /** @return true if the guard holds a page, false if it is empty (e.g. because the fetch failed) */
+  bool IsValid() const { return guard_.IsValid(); }
+
+  /** @return the id of the guarded page */
+  page_id_t PageId() { return guard_.PageId(); }
+
+  /** @return the guarded page, for page types that derive from Page */
+  Page *GetPage() { return guard_.GetPage(); }
+
+  /** @return the data of the guarded page */
+  const char *GetData() { return guard_.GetData(); }
+
+  /** @return the data of the guarded page, reinterpreted as T */
+  template <class T>
+  const T *As() {
+    return guard_.As<T>();
+  }
+
+  /** @return the data of the guarded page for modification; the page is unpinned dirty */
+  char *GetDataMut() { return guard_.GetDataMut(); }
+
+  /** @return the data of the guarded page for modification, reinterpreted as T; the page is unpinned dirty */
+  template <class T>
+  T *AsMut() {
+    return guard_.AsMut<T>();
+  }
+
+  /** Marks the page dirty, for pages that were modified through GetPage. */
+  void SetDirty() { guard_.SetDirty(); }
+
+ private:
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
+};
+
+}  // namespace bustub
@@ -33,9 +33,9 @@ namespace bustub {
  *                                free space pointer
  *
  *  Header format (size in bytes):
- *  ----------------------------------------------------------------------------
- *  | PageId (4)| LSN (4)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
- *  ----------------------------------------------------------------------------
+ *  ---------------------------------------------------------------------------------------------
+ *  | PageId (4)| LSN (4)| Checksum (4)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
+ *  ---------------------------------------------------------------------------------------------
  *  ----------------------------------------------------------------
  *  | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
  *  ----------------------------------------------------------------
@@ -122,6 +122,15 @@ class TablePage : public Page {
    */
   bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager);
 
+  /**
+   * Read a tuple from a table with an optimistic read, without latching the page. The caller must hold a pin on the
+   * page but no latch. No locks are taken, so this is only for reads that do not need them, i.e. with logging off.
+   * @param rid rid of the tuple to read
+   * @param[out] tuple the tuple that was read
+   * @return true if the read is successful (i.e. the tuple exists)
+   */
+  bool GetTupleOptimistic(const RID &rid, Tuple *tuple);
+
   /** @return the rid of the first tuple in this page */
 
   /**
@@ -140,15 +149,23 @@ class TablePage : public Page {
  private:
   static_assert(sizeof(page_id_t) == 4);
 
-  static constexpr size_t SIZE_TABLE_PAGE_HEADER = 24;
+  static constexpr size_t SIZE_TABLE_PAGE_HEADER = 28;
   static constexpr size_t SIZE_TUPLE = 8;
-  static constexpr size_t OFFSET_PREV_PAGE_ID = 8;
-  static constexpr size_t OFFSET_NEXT_PAGE_ID = 12;
-  static constexpr size_t OFFSET_FREE_SPACE = 16;
-  static constexpr size_t OFFSET_TUPLE_COUNT = 20;
-  static constexpr size_t OFFSET_TUPLE_OFFSET = 24;  // Naming things is hard.
-  static constexpr size_t OFFSET_TUPLE_SIZE = 28;
+  static constexpr size_t OFFSET_PREV_PAGE_ID = 12;
+  static constexpr size_t OFFSET_NEXT_PAGE_ID = 16;
+  static constexpr size_t OFFSET_FREE_SPACE = 20;
+  static constexpr size_t OFFSET_TUPLE_COUNT = 24;
+  static constexpr size_t OFFSET_TUPLE_OFFSET = 28;  // Naming things is hard.
+  static constexpr size_t OFFSET_TUPLE_SIZE = 32;
+  static_assert(OFFSET_PREV_PAGE_ID == SIZE_PAGE_HEADER);
+
+ public:
+  /** The largest tuple that fits into an empty page, after the header and the tuple's slot. */
+  static constexpr size_t MAX_TUPLE_SIZE = PAGE_SIZE - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE;
+  // Tuple offsets and sizes keep their top bit free for the delete flag.
+  static_assert(PAGE_SIZE < DELETE_MASK);
 
+ private:
   /** @return pointer to the end of the current free space, see header comment */
   uint32_t GetFreeSpacePointer() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_SPACE); }
 
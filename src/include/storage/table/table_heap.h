@@ -31,7 +31,7 @@ class TableHeap {
   ~TableHeap() = default;
 
   /**
-   * Create a table heap without a transaction. (open table)
+   * Create a table heap without a transaction. (open table) The heap grows in the tablespace of its first page.
    * @param buffer_pool_manager the buffer pool manager
    * @param lock_manager the lock manager
    * @param log_manager the log manager
@@ -46,12 +46,13 @@ class TableHeap {
    * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @param txn the creating transaction
+   * @param tablespace the tablespace that the pages of the heap are allocated in, which must be open
    */
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-            Transaction *txn);
+            Transaction *txn, tablespace_id_t tablespace = DiskManager::MAIN_TABLESPACE);
 
   /**
-   * Insert a tuple into the table. If the tuple is too large (>= page_size), return false.
+   * Insert a tuple into the table. If the tuple is too large (> TablePage::MAX_TUPLE_SIZE), return false.
    * @param tuple tuple to insert
    * @param[out] rid the rid of the inserted tuple
    * @param txn the transaction performing the insert
@@ -109,10 +110,32 @@ class TableHeap {
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
  private:
+  /**
+   * Asks the buffer pool to read ahead the page chain that starts at page_id, as far as the scan's ring allows.
+   * @param page_id the first page to prefetch
+   * @param strategy the ring of the scan the pages are prefetched for
+   */
+  void PrefetchPages(page_id_t page_id, const std::shared_ptr<BufferAccessStrategy> &strategy);
+
+  /**
+   * Creates a page for the heap from the heap's current extent, reserving a new extent of EXTENT_SIZE pages when it is
+   * used up, so that the pages of the heap are contiguous in the file and scans read them sequentially.
+   * @param[out] page_id id of the new page
+   * @return a write guard of the new page, empty if the buffer pool is full
+   */
+  WritePageGuard NewHeapPage(page_id_t *page_id);
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  tablespace_id_t tablespace_{DiskManager::MAIN_TABLESPACE};
+  /**
+   * Next unused page id of the current extent and the number of unused ids left in it. Pages are only added while the
+   * last page of the heap is write-latched, which serializes access.
+   */
+  page_id_t next_extent_page_id_{INVALID_PAGE_ID};
+  size_t extent_pages_left_{0};
 };
 
 }  // namespace bustub
@@ -13,7 +13,9 @@
 #pragma once
 
 #include <cassert>
+#include <memory>
 
+#include "buffer/buffer_access_strategy.h"
 #include "common/rid.h"
 #include "concurrency/transaction.h"
 #include "storage/table/tuple.h"
@@ -29,10 +31,19 @@ class TableIterator {
   friend class Cursor;
 
  public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  /**
+   * Creates an iterator positioned at a tuple.
+   * @param table_heap the table being scanned
+   * @param rid the rid of the current tuple, or an invalid rid for the end iterator
+   * @param txn the transaction performing the scan
+   * @param strategy the buffer ring that pages of the scan are read through, nullptr to use the shared pool
+   */
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                std::shared_ptr<BufferAccessStrategy> strategy = nullptr);
 
   TableIterator(const TableIterator &other)
-  :table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+  :table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_), strategy_(other.strategy_),
+  pages_until_prefetch_(other.pages_until_prefetch_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -49,9 +60,16 @@ class TableIterator {
   TableIterator operator++(int);
 
  private:
+  /** Ends the scan after a page could not be fetched, aborting its transaction. */
+  TableIterator &Abort();
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  /** Ring of frames this scan recycles, shared by copies of the iterator. */
+  std::shared_ptr<BufferAccessStrategy> strategy_;
+  /** Page boundaries left to cross before the scan asks for the next stretch of pages to be read ahead. */
+  size_t pages_until_prefetch_{0};
 };
 
 }  // namespace bustub
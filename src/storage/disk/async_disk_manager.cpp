@@ -0,0 +1,384 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.cpp
+//
+// Identification: src/storage/disk/async_disk_manager.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/async_disk_manager.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+namespace {
+
+// glibc has no wrappers for the io_uring system calls, and liburing is not a dependency.
+int IOUringSetup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IOUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+}  // namespace
+
+AsyncDiskManager::AsyncDiskManager(const std::string &db_file, DiskIOMode io_mode, bool use_io_uring)
+    : DiskManager(db_file, io_mode) {
+#ifdef BUSTUB_TSAN
+  // ThreadSanitizer cannot see the ordering the kernel provides between submissions and completions.
+  use_io_uring = false;
+#endif
+  if (IsCompressed()) {
+    // The ring reads and writes pages at their place in the database file; compressed pages live elsewhere.
+    use_io_uring = false;
+  }
+  if (use_io_uring && !SetUpRing()) {
+    LOG_DEBUG("io_uring is not available, falling back to I/O worker threads");
+  }
+  if (IsIOUringBacked()) {
+    threads_.emplace_back(&AsyncDiskManager::RunCompletions, this);
+  }
+  if (!IsIOUringBacked() || direct_io_) {
+    for (size_t i = 0; i < NUM_IO_WORKERS; ++i) {
+      threads_.emplace_back(&AsyncDiskManager::RunWorker, this);
+    }
+  }
+}
+
+AsyncDiskManager::~AsyncDiskManager() { StopIO(); }
+
+void AsyncDiskManager::ShutDown() {
+  StopIO();
+  DiskManager::ShutDown();
+}
+
+void AsyncDiskManager::ReadPageAsync(page_id_t page_id, char *page_data, IOCallback callback) {
+  std::vector<IORequest> requests;
+  requests.push_back({page_id, page_data, false, std::move(callback)});
+  SubmitBatch(std::move(requests));
+}
+
+void AsyncDiskManager::WritePageAsync(page_id_t page_id, const char *page_data, IOCallback callback) {
+  std::vector<IORequest> requests;
+  requests.push_back({page_id, const_cast<char *>(page_data), true, std::move(callback)});
+  SubmitBatch(std::move(requests));
+}
+
+std::future<bool> AsyncDiskManager::ReadPageAsync(page_id_t page_id, char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> future = promise->get_future();
+  ReadPageAsync(page_id, page_data, [promise](bool success) { promise->set_value(success); });
+  return future;
+}
+
+std::future<bool> AsyncDiskManager::WritePageAsync(page_id_t page_id, const char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> future = promise->get_future();
+  WritePageAsync(page_id, page_data, [promise](bool success) { promise->set_value(success); });
+  return future;
+}
+
+void AsyncDiskManager::SubmitBatch(std::vector<IORequest> requests) {
+  // Looking up the data files throws for a tablespace that is not open, so it is done before anything is queued.
+  for (auto &request : requests) {
+    request.fd_ = FileDescriptor(request.page_id_);
+    request.offset_ = PageOffset(request.page_id_);
+  }
+
+  std::vector<IORequest *> to_ring;
+  std::vector<IORequest *> to_workers;
+  for (auto &request : requests) {
+    auto *queued_request = new IORequest(std::move(request));
+    // The kernel rejects unaligned O_DIRECT transfers. Writes go out through an aligned copy anyway; unaligned reads
+    // go to the workers, whose synchronous calls copy through an aligned buffer.
+    bool unaligned = direct_io_ && reinterpret_cast<uintptr_t>(queued_request->page_data_) % PAGE_SIZE != 0;
+    if (!IsIOUringBacked() || (unaligned && !queued_request->is_write_)) {
+      to_workers.push_back(queued_request);
+      continue;
+    }
+    if (queued_request->is_write_) {
+      // The kernel writes the page after this returns, so it writes a checksummed copy owned by the request.
+      queued_request->staged_.reset(static_cast<char *>(aligned_alloc(PAGE_SIZE, PAGE_SIZE)));
+      memcpy(queued_request->staged_.get(), queued_request->page_data_, PAGE_SIZE);
+      StampChecksum(queued_request->page_id_, queued_request->staged_.get());
+      queued_request->page_data_ = queued_request->staged_.get();
+    }
+    to_ring.push_back(queued_request);
+  }
+
+  std::unique_lock<std::mutex> lock(latch_);
+  if (!to_workers.empty()) {
+    worker_queue_.insert(worker_queue_.end(), to_workers.begin(), to_workers.end());
+    in_flight_ += to_workers.size();
+    worker_cv_.notify_all();
+  }
+  if (!to_ring.empty()) {
+    SubmitToRing(&lock, &to_ring);
+  }
+}
+
+void AsyncDiskManager::Drain() {
+  std::unique_lock<std::mutex> lock(latch_);
+  completed_cv_.wait(lock, [&] { return in_flight_ == 0; });
+}
+
+bool AsyncDiskManager::SetUpRing() {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = IOUringSetup(QUEUE_DEPTH, &params);
+  if (ring_fd_ < 0) {
+    ring_fd_ = -1;
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+  void *sq_ring =
+      mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  sq_ring_ = sq_ring == MAP_FAILED ? nullptr : sq_ring;
+  if (sq_ring_ != nullptr && single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else if (sq_ring_ != nullptr) {
+    void *cq_ring =
+        mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    cq_ring_ = cq_ring == MAP_FAILED ? nullptr : cq_ring;
+  }
+  void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  sqes_ = sqes == MAP_FAILED ? nullptr : static_cast<io_uring_sqe *>(sqes);
+  if (sq_ring_ == nullptr || cq_ring_ == nullptr || sqes_ == nullptr) {
+    TearDownRing();
+    return false;
+  }
+
+  auto *sq = static_cast<char *>(sq_ring_);
+  auto *cq = static_cast<char *>(cq_ring_);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  sq_entries_ = params.sq_entries;
+  // Submission queue entry i always sits in slot i of the ring.
+  for (unsigned i = 0; i < sq_entries_; ++i) {
+    sq_array_[i] = i;
+  }
+  return true;
+}
+
+void AsyncDiskManager::TearDownRing() {
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  sqes_ = nullptr;
+  cq_ring_ = sq_ring_ = nullptr;
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+    ring_fd_ = -1;
+  }
+}
+
+void AsyncDiskManager::SubmitToRing(std::unique_lock<std::mutex> *lock, std::vector<IORequest *> *requests) {
+  size_t next = 0;
+  while (next < requests->size()) {
+    // Bounding the requests in flight by the submission queue size also keeps the completion queue, which is twice
+    // as large, from overflowing.
+    completed_cv_.wait(*lock, [&] { return in_flight_ < sq_entries_; });
+
+    // Only submitters write the tail, and they hold latch_.
+    unsigned tail = *sq_tail_;
+    unsigned count = 0;
+    for (; next < requests->size() && in_flight_ + count < sq_entries_; ++next, ++count) {
+      IORequest *request = (*requests)[next];
+      io_uring_sqe *sqe = &sqes_[(tail + count) & *sq_mask_];
+      memset(sqe, 0, sizeof(*sqe));
+      if (request == nullptr) {
+        sqe->opcode = IORING_OP_NOP;
+        continue;
+      }
+      sqe->opcode = request->is_write_ ? IORING_OP_WRITE : IORING_OP_READ;
+      sqe->fd = request->fd_;
+      sqe->off = static_cast<uint64_t>(request->offset_);
+      sqe->addr = reinterpret_cast<uint64_t>(request->page_data_);
+      sqe->len = PAGE_SIZE;
+      sqe->user_data = reinterpret_cast<uint64_t>(request);
+      if (request->is_write_) {
+        num_writes_ += 1;
+        page_bytes_written_ += PAGE_SIZE;
+      } else {
+        num_reads_ += 1;
+        page_bytes_read_ += PAGE_SIZE;
+      }
+    }
+    // Publish the entries before the new tail.
+    __atomic_store_n(sq_tail_, tail + count, __ATOMIC_RELEASE);
+    in_flight_ += count;
+
+    unsigned submitted = 0;
+    while (submitted < count) {
+      int ret = IOUringEnter(ring_fd_, count - submitted, 0, 0);
+      if (ret < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+        continue;
+      }
+      if (ret < 0) {
+        throw Exception("io_uring submission failed");
+      }
+      submitted += static_cast<unsigned>(ret);
+    }
+  }
+}
+
+void AsyncDiskManager::RunCompletions() {
+  bool stop = false;
+  while (!stop) {
+    if (IOUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+      LOG_DEBUG("error while waiting for io_uring completions");
+    }
+
+    // Only this thread writes the head.
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    size_t reaped = tail - head;
+    for (; head != tail; ++head) {
+      io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+      auto *request = reinterpret_cast<IORequest *>(cqe->user_data);
+      if (request == nullptr) {
+        stop = true;
+      } else {
+        CompleteRequest(request, cqe->res);
+      }
+    }
+    // Hand the entries back to the kernel once they have been read.
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+    if (reaped > 0) {
+      {
+        std::lock_guard<std::mutex> guard(latch_);
+        in_flight_ -= reaped;
+      }
+      completed_cv_.notify_all();
+    }
+  }
+}
+
+void AsyncDiskManager::CompleteRequest(IORequest *request, int result) {
+  std::unique_ptr<IORequest> owned(request);
+  bool success = result >= 0;
+  auto done = static_cast<size_t>(std::max(result, 0));
+  if (success && done < static_cast<size_t>(PAGE_SIZE)) {
+    if (!request->is_write_) {
+      // Reading past the end of the file: the rest of the page was never written.
+      memset(request->page_data_ + done, 0, PAGE_SIZE - done);
+    } else {
+      // Short write: finish it synchronously.
+      while (done < static_cast<size_t>(PAGE_SIZE)) {
+        ssize_t count =
+            pwrite(request->fd_, request->page_data_ + done, PAGE_SIZE - done, request->offset_ + done);
+        if (count < 0 && errno == EINTR) {
+          continue;
+        }
+        if (count <= 0) {
+          success = false;
+          break;
+        }
+        done += static_cast<size_t>(count);
+      }
+    }
+  }
+  if (!success) {
+    LOG_DEBUG("I/O error while %s", request->is_write_ ? "writing" : "reading");
+  } else if (!request->is_write_) {
+    success = CheckReadPage(request->page_id_, request->page_data_);
+  }
+  if (request->callback_) {
+    request->callback_(success);
+  }
+}
+
+void AsyncDiskManager::RunWorker() {
+  while (true) {
+    IORequest *request;
+    {
+      std::unique_lock<std::mutex> lock(latch_);
+      worker_cv_.wait(lock, [&] { return stopped_ || !worker_queue_.empty(); });
+      if (worker_queue_.empty()) {
+        return;
+      }
+      request = worker_queue_.front();
+      worker_queue_.pop_front();
+    }
+
+    std::unique_ptr<IORequest> owned(request);
+    bool success = true;
+    if (request->is_write_) {
+      WritePage(request->page_id_, request->page_data_);
+    } else {
+      success = ReadPage(request->page_id_, request->page_data_);
+    }
+    if (request->callback_) {
+      request->callback_(success);
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(latch_);
+      in_flight_--;
+    }
+    completed_cv_.notify_all();
+  }
+}
+
+void AsyncDiskManager::StopIO() {
+  Drain();
+  {
+    std::unique_lock<std::mutex> lock(latch_);
+    if (stopped_) {
+      return;
+    }
+    stopped_ = true;
+    if (IsIOUringBacked()) {
+      // A no-op without a request tells the completion thread to exit.
+      std::vector<IORequest *> stop{nullptr};
+      SubmitToRing(&lock, &stop);
+    }
+  }
+  worker_cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  TearDownRing();
+}
+
+}  // namespace bustub
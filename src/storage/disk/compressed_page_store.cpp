@@ -0,0 +1,314 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_page_store.cpp
+//
+// Identification: src/storage/disk/compressed_page_store.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/compressed_page_store.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/util/crc32c.h"
+#include "common/util/lz4_codec.h"
+
+namespace bustub {
+
+/** Bytes of the file read at once while the slot headers are scanned. */
+static constexpr size_t SCAN_CHUNK = 64 * 1024;
+
+CompressedPageStore::CompressedPageStore(const std::string &file_name) : free_slots_(MAX_SLOT_UNITS + 1) {
+  fd_ = open(file_name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    throw Exception("can't open page store file");
+  }
+  Load();
+}
+
+CompressedPageStore::~CompressedPageStore() {
+  ReleasePendingSlots();
+  close(fd_);
+}
+
+uint32_t CompressedPageStore::SlotUnits(uint32_t length) {
+  size_t units = (sizeof(SlotHeader) + (length & ~RAW_FLAG) + SLOT_UNIT - 1) / SLOT_UNIT;
+  return units <= MAX_SLOT_UNITS ? static_cast<uint32_t>(units) : 0;
+}
+
+/**
+ * Compress the page into this thread's slot buffer, then pick a slot for it and write it there
+ */
+size_t CompressedPageStore::Write(page_id_t page_id, const char *page_data) {
+  thread_local std::unique_ptr<char[]> slot = std::make_unique<char[]>(MAX_SLOT_UNITS * SLOT_UNIT);
+  char *payload = slot.get() + sizeof(SlotHeader);
+  uint32_t length = Lz4Codec::Compress(page_data, PAGE_SIZE, payload, PAGE_SIZE);
+  if (length == 0 || SlotUnits(length) == MAX_SLOT_UNITS) {
+    // Compression would not save a unit, so store the page as it is and skip decompressing it on reads.
+    memcpy(payload, page_data, PAGE_SIZE);
+    length = PAGE_SIZE | RAW_FLAG;
+  }
+  uint32_t units = SlotUnits(length);
+  size_t slot_size = units * SLOT_UNIT;
+  // Zero the rest of the last unit, so that no stale bytes reach the file.
+  size_t used = sizeof(SlotHeader) + (length & ~RAW_FLAG);
+  memset(slot.get() + used, 0, slot_size - used);
+
+  uint32_t checksum = Crc32c::Value(payload, length & ~RAW_FLAG);
+
+  latch_.WLock();
+  SlotHeader header{SLOT_MAGIC, page_id, length, next_generation_++, checksum};
+  memcpy(slot.get(), &header, sizeof(header));
+  auto it = locations_.find(page_id);
+  int64_t offset = TakeSlot(units);
+  WriteAt(offset, slot.get(), slot_size);
+  if (it != locations_.end()) {
+    // The old slot keeps its copy of the page until the new one is on disk.
+    pending_slots_.emplace_back(page_id, it->second);
+    stored_bytes_ -= it->second.units_ * SLOT_UNIT;
+    it->second = {offset, units, header.generation_};
+  } else {
+    locations_.emplace(page_id, Location{offset, units, header.generation_});
+    page_id_limit_ = std::max(page_id_limit_, page_id + 1);
+  }
+  stored_bytes_ += slot_size;
+  latch_.WUnlock();
+  return slot_size;
+}
+
+/**
+ * Read the page's slot and decompress it, checking that the slot holds the page
+ */
+bool CompressedPageStore::Read(page_id_t page_id, char *page_data, size_t *bytes_read) {
+  thread_local std::unique_ptr<char[]> slot = std::make_unique<char[]>(MAX_SLOT_UNITS * SLOT_UNIT);
+  latch_.RLock();
+  auto it = locations_.find(page_id);
+  if (it == locations_.end()) {
+    latch_.RUnlock();
+    memset(page_data, 0, PAGE_SIZE);
+    *bytes_read = 0;
+    return true;
+  }
+  Location location = it->second;
+  ReadAt(location.offset_, slot.get(), location.units_ * SLOT_UNIT);
+  latch_.RUnlock();
+  *bytes_read = location.units_ * SLOT_UNIT;
+  return DecodeSlot(slot.get(), page_id, location.units_, page_data);
+}
+
+bool CompressedPageStore::DecodeSlot(const char *slot, page_id_t page_id, uint32_t units, char *page_data) {
+  SlotHeader header;
+  memcpy(&header, slot, sizeof(header));
+  const char *payload = slot + sizeof(SlotHeader);
+  bool valid = header.magic_ == SLOT_MAGIC && header.page_id_ == page_id && SlotUnits(header.length_) == units &&
+               header.checksum_ == Crc32c::Value(payload, header.length_ & ~RAW_FLAG);
+  if (valid && (header.length_ & RAW_FLAG) != 0) {
+    valid = header.length_ == (PAGE_SIZE | RAW_FLAG);
+    memcpy(page_data, payload, PAGE_SIZE);
+  } else if (valid) {
+    valid = Lz4Codec::Decompress(payload, header.length_, page_data, PAGE_SIZE);
+  }
+  if (!valid) {
+    memset(page_data, 0, PAGE_SIZE);
+  }
+  return valid;
+}
+
+void CompressedPageStore::Remove(page_id_t page_id) {
+  latch_.WLock();
+  auto it = locations_.find(page_id);
+  if (it != locations_.end()) {
+    // Older copies of the page go first, so that none of them can come back once the current one is freed.
+    auto older = std::partition(pending_slots_.begin(), pending_slots_.end(),
+                                [&](const auto &pending) { return pending.first != page_id; });
+    for (auto pending = older; pending != pending_slots_.end(); ++pending) {
+      FreeSlot(pending->second.offset_, pending->second.units_);
+    }
+    pending_slots_.erase(older, pending_slots_.end());
+    FreeSlot(it->second.offset_, it->second.units_);
+    stored_bytes_ -= it->second.units_ * SLOT_UNIT;
+    locations_.erase(it);
+  }
+  latch_.WUnlock();
+}
+
+void CompressedPageStore::Sync() {
+  latch_.WLock();
+  if (pending_slots_.empty() && fsync(fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing page store");
+  }
+  ReleasePendingSlots();
+  latch_.WUnlock();
+}
+
+page_id_t CompressedPageStore::GetPageIdLimit() {
+  latch_.RLock();
+  page_id_t limit = page_id_limit_;
+  latch_.RUnlock();
+  return limit;
+}
+
+size_t CompressedPageStore::GetStoredBytes() {
+  latch_.RLock();
+  size_t bytes = stored_bytes_;
+  latch_.RUnlock();
+  return bytes;
+}
+
+/**
+ * Private helper function to walk the slot headers from the start of the file. A slot whose header is damaged is
+ * taken to be one free unit, so the walk resynchronizes at the next slot; a slot cut off by the end of the file was
+ * being appended when the process stopped, and is overwritten by the next append. Of two slots that claim one page,
+ * the newer is kept unless a torn write left it damaged.
+ */
+void CompressedPageStore::Load() {
+  struct stat stat_buf;
+  int64_t file_size = fstat(fd_, &stat_buf) == 0 ? static_cast<int64_t>(stat_buf.st_size) : 0;
+  auto chunk = std::make_unique<char[]>(SCAN_CHUNK);
+  auto slot = std::make_unique<char[]>(MAX_SLOT_UNITS * SLOT_UNIT);
+  auto page_data = std::make_unique<char[]>(PAGE_SIZE);
+  int64_t chunk_offset = 0;
+  int64_t chunk_size = 0;
+  int64_t offset = 0;
+  while (offset + static_cast<int64_t>(sizeof(SlotHeader)) <= file_size) {
+    if (offset + static_cast<int64_t>(sizeof(SlotHeader)) > chunk_offset + chunk_size) {
+      chunk_offset = offset;
+      chunk_size = std::min<int64_t>(SCAN_CHUNK, file_size - offset);
+      ReadAt(chunk_offset, chunk.get(), chunk_size);
+    }
+    SlotHeader header;
+    memcpy(&header, chunk.get() + (offset - chunk_offset), sizeof(header));
+    uint32_t units = header.magic_ == SLOT_MAGIC ? SlotUnits(header.length_) : 0;
+    if (units == 0) {
+      free_slots_[1].push_back(offset);
+      offset += SLOT_UNIT;
+      continue;
+    }
+    if (offset + static_cast<int64_t>(units * SLOT_UNIT) > file_size) {
+      break;
+    }
+    next_generation_ = std::max(next_generation_, header.generation_ + 1);
+    if (header.page_id_ == INVALID_PAGE_ID) {
+      free_slots_[units].push_back(offset);
+    } else {
+      Location location{offset, units, header.generation_};
+      auto [it, inserted] = locations_.emplace(header.page_id_, location);
+      if (!inserted) {
+        // Two slots claim the page: keep the newer intact copy and free the other, so that it cannot come back later.
+        Location *newer = it->second.generation_ < header.generation_ ? &location : &it->second;
+        ReadAt(newer->offset_, slot.get(), newer->units_ * SLOT_UNIT);
+        bool newer_intact = DecodeSlot(slot.get(), header.page_id_, newer->units_, page_data.get());
+        if ((newer == &location) == newer_intact) {
+          std::swap(it->second, location);
+        }
+        FreeSlot(location.offset_, location.units_);
+      }
+    }
+    offset += static_cast<int64_t>(units * SLOT_UNIT);
+  }
+  end_offset_ = offset;
+  for (const auto &[page_id, location] : locations_) {
+    page_id_limit_ = std::max(page_id_limit_, page_id + 1);
+    stored_bytes_ += location.units_ * SLOT_UNIT;
+  }
+}
+
+void CompressedPageStore::FreeSlot(int64_t offset, uint32_t units) {
+  // The length field keeps the slot's size, so that the slot is found again when the file is reopened.
+  SlotHeader header{SLOT_MAGIC, INVALID_PAGE_ID, static_cast<uint32_t>(units * SLOT_UNIT - sizeof(SlotHeader)),
+                    next_generation_++, 0};
+  WriteAt(offset, reinterpret_cast<const char *>(&header), sizeof(header));
+  free_slots_[units].push_back(offset);
+}
+
+/**
+ * Private helper function to find room for a slot. Freed slots are only released by a sync, so one is done if that
+ * would give a slot to reuse instead of growing the file.
+ */
+int64_t CompressedPageStore::TakeSlot(uint32_t units) {
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    if (attempt == 1) {
+      if (pending_slots_.empty()) {
+        break;
+      }
+      ReleasePendingSlots();
+    }
+    for (size_t size = units; size <= MAX_SLOT_UNITS; ++size) {
+      if (free_slots_[size].empty()) {
+        continue;
+      }
+      int64_t offset = free_slots_[size].back();
+      free_slots_[size].pop_back();
+      if (size > units) {
+        // The rest of the slot becomes a free slot of its own, whose header is written before the front is reused.
+        FreeSlot(offset + static_cast<int64_t>(units * SLOT_UNIT), static_cast<uint32_t>(size - units));
+      }
+      return offset;
+    }
+  }
+  int64_t offset = end_offset_;
+  end_offset_ += static_cast<int64_t>(units * SLOT_UNIT);
+  return offset;
+}
+
+void CompressedPageStore::ReleasePendingSlots() {
+  if (pending_slots_.empty()) {
+    return;
+  }
+  if (fsync(fd_) != 0) {
+    // The new slots may not be on disk, so the old ones must stay.
+    LOG_DEBUG("I/O error while syncing page store");
+    return;
+  }
+  for (const auto &[page_id, location] : pending_slots_) {
+    FreeSlot(location.offset_, location.units_);
+  }
+  pending_slots_.clear();
+}
+
+void CompressedPageStore::WriteAt(int64_t offset, const char *data, size_t count) {
+  size_t done = 0;
+  while (done < count) {
+    ssize_t written = pwrite(fd_, data + done, count - done, offset + done);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      LOG_DEBUG("I/O error while writing page store");
+      return;
+    }
+    done += static_cast<size_t>(written);
+  }
+}
+
+void CompressedPageStore::ReadAt(int64_t offset, char *data, size_t count) {
+  size_t done = 0;
+  while (done < count) {
+    ssize_t read = pread(fd_, data + done, count - done, offset + done);
+    if (read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read < 0) {
+      LOG_DEBUG("I/O error while reading page store");
+    }
+    if (read <= 0) {
+      memset(data + done, 0, count - done);
+      return;
+    }
+    done += static_cast<size_t>(read);
+  }
+}
+
+}  // namespace bustub
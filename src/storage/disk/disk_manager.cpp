@@ -10,15 +10,25 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/macros.h"
+#include "common/util/crc32c.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
@@ -29,14 +39,22 @@ static char *buffer_used;
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, DiskIOMode io_mode)
+    : io_mode_(io_mode), file_name_(db_file), num_flushes_(0), flush_log_(false), flush_log_f_(nullptr) {
+  files_[MAIN_TABLESPACE] = std::make_unique<DataFile>();
+  files_[MAIN_TABLESPACE]->file_name_ = db_file;
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  if (io_mode == DiskIOMode::MMAP_READ_ONLY) {
+    // a read-only replica neither writes a log nor creates files
+    MapFile(db_file);
+    LoadFreeSpaceMaps(files_[MAIN_TABLESPACE].get());
+    return;
+  }
 
   log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
   // directory or file does not exist
@@ -52,27 +70,66 @@ DiskManager::DiskManager(const std::string &db_file)
     }
   }
 
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-    if (!db_io_.is_open()) {
-      throw Exception("can't open db file");
-    }
+  direct_io_ = io_mode == DiskIOMode::DIRECT;
+  int fd = OpenDataFile(db_file, &direct_io_);
+  if (fd < 0) {
+    throw Exception("can't open db file");
   }
+  files_[MAIN_TABLESPACE]->fd_ = fd;
+  if (io_mode == DiskIOMode::COMPRESSED) {
+    page_store_ = std::make_unique<CompressedPageStore>(file_name_.substr(0, n) + ".pages");
+  }
+  LoadFreeSpaceMaps(files_[MAIN_TABLESPACE].get());
   buffer_used = nullptr;
 }
 
+/**
+ * Private helper function to open (or create) a data file, with O_DIRECT if it is asked for and supported
+ */
+int DiskManager::OpenDataFile(const std::string &file_name, bool *direct_io) {
+  int fd = -1;
+  if (*direct_io) {
+    fd = open(file_name.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    *direct_io = fd >= 0;
+    if (!*direct_io) {
+      LOG_DEBUG("direct I/O is not supported for %s, falling back to buffered I/O", file_name.c_str());
+    }
+  }
+  if (fd < 0) {
+    // create the file if it does not exist
+    fd = open(file_name.c_str(), O_RDWR | O_CREAT, 0644);
+  }
+  return fd;
+}
+
+DiskManager::~DiskManager() {
+  // A disk manager destroyed without ShutDown still lets go of its data files.
+  for (auto &file : files_) {
+    if (file != nullptr && file->fd_ >= 0) {
+      close(file->fd_);
+    }
+  }
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+}
+
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
-  db_io_.close();
+  for (auto &file : files_) {
+    if (file != nullptr && file->fd_ >= 0) {
+      close(file->fd_);
+      file->fd_ = -1;
+    }
+  }
+  page_store_.reset();
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+    mapping_ = nullptr;
+    mapped_pages_ = 0;
+  }
   log_io_.close();
 }
 
@@ -80,45 +137,198 @@ void DiskManager::ShutDown() {
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
   num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
+  if (page_store_ != nullptr) {
+    page_bytes_written_ += page_store_->Write(page_id, StagePages(page_id, &page_data, 1));
     return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  page_bytes_written_ += PAGE_SIZE;
+  PageIO(FileDescriptor(page_id), PageOffset(page_id), StagePages(page_id, &page_data, 1), true);
+}
+
+/**
+ * Write a run of consecutive pages into disk file, split where a free-space map page interrupts the run. Map intervals
+ * never span tablespaces, so every part of the run lies in a single data file.
+ */
+void DiskManager::WritePages(page_id_t first_page_id, const char *const *pages, size_t num_pages) {
+  if (page_store_ != nullptr) {
+    // Compressed pages have slots of their own, which are not contiguous.
+    for (size_t i = 0; i < num_pages; ++i) {
+      WritePage(first_page_id + static_cast<page_id_t>(i), pages[i]);
+    }
+    return;
+  }
+  num_writes_ += num_pages;
+  page_bytes_written_ += static_cast<int64_t>(num_pages * PAGE_SIZE);
+  size_t done = 0;
+  while (done < num_pages) {
+    page_id_t page_id = first_page_id + static_cast<page_id_t>(done);
+    size_t count = std::min(num_pages - done, PAGES_PER_MAP - static_cast<size_t>(page_id) % PAGES_PER_MAP);
+    WriteRun(page_id, pages + done, count);
+    done += count;
+  }
+}
+
+/**
+ * Write a physically contiguous run of pages, staged and checksummed STAGING_PAGES at a time
+ */
+void DiskManager::WriteRun(page_id_t first_page_id, const char *const *pages, size_t num_pages) {
+  int fd = FileDescriptor(first_page_id);
+  for (size_t done = 0; done < num_pages; done += STAGING_PAGES) {
+    size_t count = std::min(num_pages - done, STAGING_PAGES);
+    auto page_id = first_page_id + static_cast<page_id_t>(done);
+    PageIO(fd, PageOffset(page_id), StagePages(page_id, pages + done, count), true, count * PAGE_SIZE);
+  }
+}
+
+/**
+ * Copy pages into this thread's staging buffer and stamp their checksums on the copies
+ */
+char *DiskManager::StagePages(page_id_t first_page_id, const char *const *pages, size_t num_pages) {
+  // Page-aligned, so that the staged pages can be written with direct I/O as they are.
+  thread_local std::unique_ptr<char, decltype(&free)> staging(
+      static_cast<char *>(aligned_alloc(PAGE_SIZE, STAGING_PAGES * PAGE_SIZE)), &free);
+  for (size_t i = 0; i < num_pages; ++i) {
+    char *copy = staging.get() + i * PAGE_SIZE;
+    memcpy(copy, pages[i], PAGE_SIZE);
+    StampChecksum(first_page_id + static_cast<page_id_t>(i), copy);
+  }
+  return staging.get();
+}
+
+/**
+ * Force the data files to disk
+ */
+void DiskManager::SyncPages() {
+  std::lock_guard<std::mutex> guard(tablespace_latch_);
+  for (auto &file : files_) {
+    if (file == nullptr) {
+      continue;
+    }
+    // The free-space maps were written when they changed, so this forces them to disk, too.
+    if (fsync(file->fd_) != 0) {
+      LOG_DEBUG("I/O error while syncing %s", file->file_name_.c_str());
+    }
+  }
+  if (page_store_ != nullptr) {
+    page_store_->Sync();
+  }
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
+bool DiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  num_reads_ += 1;
+  if (mapping_ != nullptr) {
+    const char *page = GetMappedPage(page_id);
+    if (page == nullptr) {
+      // the page lies past the end of the file as it was mapped
+      memset(page_data, 0, PAGE_SIZE);
+      return true;
+    }
+    memcpy(page_data, page, PAGE_SIZE);
+  } else if (page_store_ != nullptr) {
+    size_t bytes_read;
+    bool intact = page_store_->Read(page_id, page_data, &bytes_read);
+    page_bytes_read_ += static_cast<int64_t>(bytes_read);
+    if (!intact) {
+      num_checksum_failures_ += 1;
+      LOG_ERROR("damaged page store slot for page %d", page_id);
+      return false;
+    }
   } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    if (db_io_.bad()) {
-      LOG_DEBUG("I/O error while reading");
-      return;
+    page_bytes_read_ += PAGE_SIZE;
+    PageIO(FileDescriptor(page_id), PageOffset(page_id), page_data, false);
+  }
+  return CheckReadPage(page_id, page_data);
+}
+
+bool DiskManager::CheckReadPage(page_id_t page_id, const char *page_data) {
+  if (VerifyChecksum(page_id, page_data)) {
+    return true;
+  }
+  num_checksum_failures_ += 1;
+  LOG_ERROR("checksum mismatch on page %d", page_id);
+  return false;
+}
+
+/**
+ * CRC-32C of the page id followed by the page, leaving out the checksum field
+ */
+uint32_t DiskManager::ComputeChecksum(page_id_t page_id, const char *page_data) {
+  constexpr size_t after_checksum = Page::OFFSET_CHECKSUM + sizeof(uint32_t);
+  uint32_t crc = Crc32c::Value(reinterpret_cast<const char *>(&page_id), sizeof(page_id));
+  crc = Crc32c::Extend(crc, page_data, Page::OFFSET_CHECKSUM);
+  return Crc32c::Extend(crc, page_data + after_checksum, PAGE_SIZE - after_checksum);
+}
+
+bool DiskManager::VerifyChecksum(page_id_t page_id, const char *page_data) {
+  uint32_t stored;
+  memcpy(&stored, page_data + Page::OFFSET_CHECKSUM, sizeof(stored));
+  if (stored == ComputeChecksum(page_id, page_data)) {
+    return true;
+  }
+  // A page that was allocated but never written reads as zeroes and has no checksum yet.
+  return stored == 0 && page_data[0] == 0 && memcmp(page_data, page_data + 1, PAGE_SIZE - 1) == 0;
+}
+
+/**
+ * Hint the kernel to read ahead a run of mapped pages that is about to be scanned
+ */
+void DiskManager::AdviseSequential(page_id_t first_page_id, size_t num_pages) {
+  if (mapping_ == nullptr || first_page_id < 0 || static_cast<size_t>(first_page_id) >= mapped_pages_) {
+    return;
+  }
+  num_pages = std::min(num_pages, mapped_pages_ - static_cast<size_t>(first_page_id));
+  if (num_pages == 0) {
+    return;
+  }
+  // madvise wants an address aligned to the system page size
+  static const int64_t system_page_size = sysconf(_SC_PAGESIZE);
+  int64_t begin = PageOffset(first_page_id) / system_page_size * system_page_size;
+  int64_t end = PageOffset(first_page_id + static_cast<page_id_t>(num_pages) - 1) + PAGE_SIZE;
+  madvise(mapping_ + begin, end - begin, MADV_SEQUENTIAL);
+  madvise(mapping_ + begin, end - begin, MADV_WILLNEED);
+}
+
+/**
+ * Read or write pages at the given offset in a data file. pread/pwrite carry their own offset, so no latch is needed
+ */
+void DiskManager::PageIO(int fd, int64_t offset, char *page_data, bool is_write, size_t length) {
+  // O_DIRECT transfers need a buffer aligned to the logical block size; frames of the buffer pool already are.
+  thread_local std::unique_ptr<char, decltype(&free)> bounce(nullptr, &free);
+  bool aligned = !direct_io_ || reinterpret_cast<uintptr_t>(page_data) % PAGE_SIZE == 0;
+  BUSTUB_ASSERT(aligned || length == static_cast<size_t>(PAGE_SIZE), "Only single pages go through the bounce buffer.");
+  if (!aligned && bounce == nullptr) {
+    bounce.reset(static_cast<char *>(aligned_alloc(PAGE_SIZE, PAGE_SIZE)));
+  }
+  char *buffer = aligned ? page_data : bounce.get();
+  if (is_write && !aligned) {
+    memcpy(buffer, page_data, PAGE_SIZE);
+  }
+
+  size_t done = 0;
+  while (done < length) {
+    ssize_t count = is_write ? pwrite(fd, buffer + done, length - done, offset + done)
+                             : pread(fd, buffer + done, length - done, offset + done);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0) {
+      LOG_DEBUG("I/O error while %s", is_write ? "writing" : "reading");
+      break;
     }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    if (count == 0) {
+      // Reading past the end of the file: the rest of the page was never written.
+      memset(buffer + done, 0, length - done);
+      break;
     }
+    done += static_cast<size_t>(count);
+  }
+
+  if (!is_write && !aligned) {
+    memcpy(page_data, buffer, PAGE_SIZE);
   }
 }
 
@@ -186,16 +396,161 @@ bool DiskManager::ReadLog(char *log_data, int size, int offset) {
 
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * Reuse a freed page of the right residue if there is one, otherwise extend the file
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AllocatePage(uint32_t modulus, uint32_t residue, tablespace_id_t tablespace) {
+  DataFile *file = GetDataFile(tablespace);
+  std::lock_guard<std::mutex> guard(file->alloc_latch_);
+  FreeLists &free_lists = GetFreeLists(file, modulus);
+  std::vector<page_id_t> &free_pages = free_lists.lists_[residue];
+  while (!free_pages.empty()) {
+    page_id_t page_id = free_pages.back();
+    free_pages.pop_back();
+    free_lists.entries_--;
+    // Pages allocated through another modulus are still on this list.
+    if (!TestAllocated(*file, page_id)) {
+      SetAllocated(file, page_id, true);
+      WriteFreeSpaceMaps(file);
+      return page_id;
+    }
+  }
+  // The pages between the end of the file and the next page id of the residue are left free for the other residues.
+  page_id_t next_page_id = file->next_page_id_;
+  page_id_t page_id = next_page_id + static_cast<page_id_t>((residue + modulus - next_page_id % modulus) % modulus);
+  if (static_cast<size_t>(page_id - file->first_page_id_) >= GetTablespacePages(tablespace)) {
+    LOG_WARN("tablespace %u is full", tablespace);
+    return INVALID_PAGE_ID;
+  }
+  for (page_id_t skipped = next_page_id; skipped < page_id; ++skipped) {
+    AddFreePage(file, skipped);
+  }
+  file->next_page_id_ = page_id + 1;
+  SetAllocated(file, page_id, true);
+  WriteFreeSpaceMaps(file);
+  Preallocate(file);
+  return page_id;
+}
+
+/**
+ * Allocate consecutive pages at the end of the file, skipping to the next map interval if the run would cross a map
+ */
+page_id_t DiskManager::AllocateExtent(size_t num_pages, tablespace_id_t tablespace) {
+  BUSTUB_ASSERT(num_pages > 0 && num_pages <= PAGES_PER_MAP, "An extent must fit between two free-space maps.");
+  DataFile *file = GetDataFile(tablespace);
+  std::lock_guard<std::mutex> guard(file->alloc_latch_);
+  auto first_page_id = static_cast<size_t>(file->next_page_id_);
+  if (first_page_id / PAGES_PER_MAP != (first_page_id + num_pages - 1) / PAGES_PER_MAP) {
+    first_page_id = (first_page_id / PAGES_PER_MAP + 1) * PAGES_PER_MAP;
+  }
+  if (first_page_id + num_pages - file->first_page_id_ > GetTablespacePages(tablespace)) {
+    LOG_WARN("tablespace %u is full", tablespace);
+    return INVALID_PAGE_ID;
+  }
+  for (auto skipped = file->next_page_id_; skipped < static_cast<page_id_t>(first_page_id); ++skipped) {
+    AddFreePage(file, skipped);
+  }
+  for (size_t i = 0; i < num_pages; ++i) {
+    SetAllocated(file, static_cast<page_id_t>(first_page_id + i), true);
+  }
+  file->next_page_id_ = static_cast<page_id_t>(first_page_id + num_pages);
+  WriteFreeSpaceMaps(file);
+  Preallocate(file);
+  return static_cast<page_id_t>(first_page_id);
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
- * This does not actually need to do anything for now.
+ * Clear its bit in the free-space map and put it on the free lists of its residue
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {}
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  if (page_id < 0 || !HasTablespace(GetTablespace(page_id))) {
+    LOG_DEBUG("deallocating page %d, whose tablespace is not open", page_id);
+    return;
+  }
+  DataFile *file = files_[GetTablespace(page_id)].get();
+  std::lock_guard<std::mutex> guard(file->alloc_latch_);
+  if (page_id >= file->next_page_id_ || !TestAllocated(*file, page_id)) {
+    LOG_DEBUG("deallocating page %d, which is not allocated", page_id);
+    return;
+  }
+  SetAllocated(file, page_id, false);
+  WriteFreeSpaceMaps(file);
+  AddFreePage(file, page_id);
+  if (page_store_ != nullptr) {
+    page_store_->Remove(page_id);
+  }
+}
+
+bool DiskManager::IsAllocated(page_id_t page_id) {
+  if (page_id < 0 || !HasTablespace(GetTablespace(page_id))) {
+    return false;
+  }
+  DataFile *file = files_[GetTablespace(page_id)].get();
+  std::lock_guard<std::mutex> guard(file->alloc_latch_);
+  return page_id < file->next_page_id_ && TestAllocated(*file, page_id);
+}
+
+/**
+ * Open the data file of a tablespace next to the database file (or in the given directory) and load its maps
+ */
+std::string DiskManager::OpenTablespace(tablespace_id_t tablespace, const std::string &directory) {
+  if (tablespace == MAIN_TABLESPACE || tablespace >= MAX_TABLESPACES) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "invalid tablespace id");
+  }
+  if (!SupportsTablespaces()) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "tablespaces need buffered or direct I/O");
+  }
+  std::string::size_type slash = file_name_.rfind('/');
+  std::string dir = slash == std::string::npos ? "" : file_name_.substr(0, slash + 1);
+  if (!directory.empty()) {
+    dir = directory.back() == '/' ? directory : directory + "/";
+  }
+  std::string base = file_name_.substr(slash == std::string::npos ? 0 : slash + 1);
+  std::string::size_type dot = std::min(base.rfind('.'), base.size());
+  std::string file_name = dir + base.substr(0, dot) + "." + std::to_string(tablespace) + base.substr(dot);
+
+  std::lock_guard<std::mutex> guard(tablespace_latch_);
+  if (files_[tablespace] != nullptr) {
+    throw Exception(ExceptionType::INVALID, "tablespace is already open");
+  }
+  auto file = std::make_unique<DataFile>();
+  file->file_name_ = file_name;
+  file->first_page_id_ = GetFirstPageId(tablespace);
+  // A tablespace on a file system without direct I/O falls back to buffered I/O; the bounce buffer then does no harm.
+  bool direct_io = direct_io_;
+  file->fd_ = OpenDataFile(file_name, &direct_io);
+  if (file->fd_ < 0) {
+    throw Exception("can't open tablespace file");
+  }
+  LoadFreeSpaceMaps(file.get());
+  files_[tablespace] = std::move(file);
+  return file_name;
+}
+
+/**
+ * Close the data file of a tablespace and unlink it
+ */
+void DiskManager::DropTablespace(tablespace_id_t tablespace) {
+  BUSTUB_ASSERT(tablespace != MAIN_TABLESPACE, "The main tablespace cannot be dropped.");
+  std::lock_guard<std::mutex> guard(tablespace_latch_);
+  GetDataFile(tablespace);
+  std::unique_ptr<DataFile> file = std::move(files_[tablespace]);
+  close(file->fd_);
+  if (unlink(file->file_name_.c_str()) != 0) {
+    LOG_DEBUG("can't unlink tablespace file %s", file->file_name_.c_str());
+  }
+}
+
+int DiskManager::FileDescriptor(page_id_t page_id) const {
+  return GetDataFile(GetTablespace(page_id))->fd_;
+}
+
+DiskManager::DataFile *DiskManager::GetDataFile(tablespace_id_t tablespace) const {
+  if (!HasTablespace(tablespace)) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "tablespace is not open");
+  }
+  return files_[tablespace].get();
+}
 
 /**
  * Returns number of flushes made so far
@@ -207,6 +562,11 @@ int DiskManager::GetNumFlushes() const { return num_flushes_; }
  */
 int DiskManager::GetNumWrites() const { return num_writes_; }
 
+/**
+ * Returns number of page reads made so far
+ */
+int DiskManager::GetNumReads() const { return num_reads_; }
+
 /**
  * Returns true if the log is currently being flushed
  */
@@ -215,10 +575,156 @@ bool DiskManager::GetFlushState() const { return flush_log_; }
 /**
  * Private helper function to get disk file size
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
+int64_t DiskManager::GetFileSize(const std::string &file_name) {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
-  return rc == 0 ? static_cast<int>(stat_buf.st_size) : -1;
+  return rc == 0 ? static_cast<int64_t>(stat_buf.st_size) : -1;
+}
+
+/**
+ * Private helper function to open the db file read-only and map all of it
+ */
+void DiskManager::MapFile(const std::string &db_file) {
+  int fd = open(db_file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw Exception("can't open db file");
+  }
+  files_[MAIN_TABLESPACE]->fd_ = fd;
+  int64_t file_size = std::max<int64_t>(GetFileSize(db_file), 0);
+  if (file_size < PAGE_SIZE) {
+    // nothing but (part of) the first free-space map; mmap cannot map an empty file anyway
+    return;
+  }
+  void *mapping = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    throw Exception("can't map db file");
+  }
+  mapping_ = static_cast<char *>(mapping);
+  mapping_size_ = static_cast<size_t>(file_size);
+  int64_t file_pages = file_size / PAGE_SIZE;
+  auto interval_pages = static_cast<int64_t>(PAGES_PER_MAP) + 1;
+  mapped_pages_ = static_cast<size_t>(file_pages - (file_pages + interval_pages - 1) / interval_pages);
+}
+
+/**
+ * Private helper function to read the free-space maps when a data file is opened
+ */
+void DiskManager::LoadFreeSpaceMaps(DataFile *file) {
+  // Every map page is followed by the PAGES_PER_MAP pages it describes; the last interval may be incomplete.
+  int64_t file_size = std::max<int64_t>(GetFileSize(file->file_name_), 0);
+  int64_t file_pages = file_size / PAGE_SIZE;
+  auto interval_pages = static_cast<int64_t>(PAGES_PER_MAP) + 1;
+  int64_t num_maps = (file_pages + interval_pages - 1) / interval_pages;
+  // The maps are written whenever they change, so a clear bit means the page is free. Freed pages past the last
+  // allocated one may still be in the file; next_page_id_ stays past them, so that they are reused from the free lists.
+  auto high_water = static_cast<page_id_t>(file_pages - num_maps);
+  if (page_store_ != nullptr) {
+    high_water = std::max(high_water, page_store_->GetPageIdLimit());
+  }
+  file->free_space_maps_.resize(num_maps);
+  file->map_dirty_.assign(num_maps, false);
+  for (int64_t i = 0; i < num_maps; ++i) {
+    file->free_space_maps_[i] = std::make_unique<char[]>(PAGE_SIZE);
+    PageIO(file->fd_, i * interval_pages * PAGE_SIZE, file->free_space_maps_[i].get(), false);
+    for (int64_t byte = PAGE_SIZE - 1; byte >= 0; --byte) {
+      auto bits = static_cast<unsigned char>(file->free_space_maps_[i][byte]);
+      if (bits != 0) {
+        auto last = static_cast<page_id_t>(i * PAGES_PER_MAP + byte * 8 + (31 - __builtin_clz(bits)));
+        high_water = std::max(high_water, last + 1);
+        break;
+      }
+    }
+  }
+  std::lock_guard<std::mutex> guard(file->alloc_latch_);
+  file->next_page_id_ = file->first_page_id_ + high_water;
+  file->preallocated_bytes_ = file_size;
+  file->free_pages_.clear();
+}
+
+/**
+ * Private helper function to write the free-space maps of a data file that changed since they were last written
+ */
+void DiskManager::WriteFreeSpaceMaps(DataFile *file) {
+  for (size_t i = 0; i < file->free_space_maps_.size(); ++i) {
+    if (file->map_dirty_[i]) {
+      PageIO(file->fd_, static_cast<int64_t>(i * (PAGES_PER_MAP + 1) * PAGE_SIZE), file->free_space_maps_[i].get(),
+             true);
+      file->map_dirty_[i] = false;
+    }
+  }
+}
+
+/**
+ * Private helper function to reserve disk space ahead of the pages allocated in a data file, so that the file grows
+ * in large contiguous steps. The file size stays as it is, since it tells which pages were written.
+ */
+void DiskManager::Preallocate(DataFile *file) {
+  if (page_store_ != nullptr) {
+    // the pages live in the page store, which grows by itself
+    return;
+  }
+  int64_t end = PageOffset(file->next_page_id_ - 1) + PAGE_SIZE;
+  if (end <= file->preallocated_bytes_) {
+    return;
+  }
+  int64_t target = PageOffset(file->next_page_id_ - 1 + PREALLOCATE_PAGES) + PAGE_SIZE;
+  if (fallocate(file->fd_, FALLOC_FL_KEEP_SIZE, file->preallocated_bytes_, target - file->preallocated_bytes_) != 0) {
+    // Not every file system supports fallocate; the file then grows as pages are written.
+    LOG_DEBUG("can't preallocate %s", file->file_name_.c_str());
+  }
+  file->preallocated_bytes_ = target;
+}
+
+bool DiskManager::TestAllocated(const DataFile &file, page_id_t page_id) {
+  auto page_no = static_cast<size_t>(page_id - file.first_page_id_);
+  size_t map = page_no / PAGES_PER_MAP;
+  size_t bit = page_no % PAGES_PER_MAP;
+  return map < file.free_space_maps_.size() && ((file.free_space_maps_[map][bit / 8] >> (bit % 8)) & 1) != 0;
+}
+
+void DiskManager::SetAllocated(DataFile *file, page_id_t page_id, bool allocated) {
+  auto page_no = static_cast<size_t>(page_id - file->first_page_id_);
+  size_t map = page_no / PAGES_PER_MAP;
+  size_t bit = page_no % PAGES_PER_MAP;
+  while (map >= file->free_space_maps_.size()) {
+    file->free_space_maps_.push_back(std::make_unique<char[]>(PAGE_SIZE));
+    file->map_dirty_.push_back(false);
+  }
+  auto mask = static_cast<char>(1 << (bit % 8));
+  char &byte = file->free_space_maps_[map][bit / 8];
+  byte = allocated ? static_cast<char>(byte | mask) : static_cast<char>(byte & ~mask);
+  file->map_dirty_[map] = true;
+}
+
+DiskManager::FreeLists &DiskManager::GetFreeLists(DataFile *file, uint32_t modulus) {
+  auto lists = file->free_pages_.find(modulus);
+  if (lists != file->free_pages_.end()) {
+    return lists->second;
+  }
+  FreeLists &free_lists = file->free_pages_[modulus];
+  free_lists.lists_.resize(modulus);
+  // Push in descending order, so that the lowest free pages are reused first.
+  for (page_id_t page_id = file->next_page_id_ - 1; page_id >= file->first_page_id_; --page_id) {
+    if (!TestAllocated(*file, page_id)) {
+      free_lists.lists_[page_id % modulus].push_back(page_id);
+      free_lists.entries_++;
+    }
+  }
+  return free_lists;
+}
+
+void DiskManager::AddFreePage(DataFile *file, page_id_t page_id) {
+  // Building the lists costs a pass over the pages, which the pushes since they were last built pay for.
+  auto num_pages = static_cast<size_t>(file->next_page_id_ - file->first_page_id_);
+  for (auto it = file->free_pages_.begin(); it != file->free_pages_.end();) {
+    auto &[modulus, free_lists] = *it;
+    free_lists.lists_[page_id % modulus].push_back(page_id);
+    if (++free_lists.entries_ > 2 * num_pages) {
+      it = file->free_pages_.erase(it);
+    } else {
+      ++it;
+    }
+  }
 }
 
 }  // namespace bustub
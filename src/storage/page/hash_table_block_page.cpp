@@ -10,6 +10,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+
 #include "storage/page/hash_table_block_page.h"
 #include "storage/index/generic_key.h"
 
@@ -17,6 +19,8 @@ namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 KeyType HASH_TABLE_BLOCK_TYPE::KeyAt(slot_offset_t bucket_ind) const {
+  static_assert(sizeof(HashTableBlockPage) + BLOCK_ARRAY_SIZE * sizeof(MappingType) <= PAGE_SIZE,
+                "A block page must fit into a page.");
   return array_[bucket_ind].first;
 }
 
@@ -27,28 +31,72 @@ ValueType HASH_TABLE_BLOCK_TYPE::ValueAt(slot_offset_t bucket_ind) const {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BLOCK_TYPE::Insert(slot_offset_t bucket_ind, const KeyType &key, const ValueType &value) {
-  if(occupied_[bucket_ind]=='1')return false;
-  occupied_[bucket_ind]='1';
+  if (IsOccupied(bucket_ind)) {
+    return false;
+  }
+  auto mask = static_cast<char>(1 << (bucket_ind % 8));
   array_[bucket_ind] = std::make_pair(key, value);
-  readable_[bucket_ind]='1';
+  // Writers hold the block's write latch; the flags are atomic for optimistic readers.
+  occupied_[bucket_ind / 8].fetch_or(mask);
+  readable_[bucket_ind / 8].fetch_or(mask);
   return true;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_BLOCK_TYPE::Remove(slot_offset_t bucket_ind) {
-  readable_[bucket_ind]='0';
+  readable_[bucket_ind / 8].fetch_and(static_cast<char>(~(1 << (bucket_ind % 8))));
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BLOCK_TYPE::IsOccupied(slot_offset_t bucket_ind) const {
-  if(occupied_[bucket_ind]=='1')return true;
-  return false;
+  return ((occupied_[bucket_ind / 8].load() >> (bucket_ind % 8)) & 1) != 0;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BLOCK_TYPE::IsReadable(slot_offset_t bucket_ind) const {
-  if(readable_[bucket_ind]=='1')return true;
-  return false;
+  return ((readable_[bucket_ind / 8].load() >> (bucket_ind % 8)) & 1) != 0;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint64_t HASH_TABLE_BLOCK_TYPE::LoadBits(const std::atomic_char *bitmap, slot_offset_t from, size_t *num_bits) {
+  size_t byte = from / 8;
+  size_t num_bytes = std::min<size_t>(sizeof(uint64_t), BITMAP_SIZE - byte);
+  uint64_t word = 0;
+  for (size_t i = 0; i < num_bytes; i++) {
+    auto bits = static_cast<unsigned char>(bitmap[byte + i].load(std::memory_order_acquire));
+    word |= static_cast<uint64_t>(bits) << (8 * i);
+  }
+  *num_bits = 8 * num_bytes - from % 8;
+  return word >> (from % 8);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+slot_offset_t HASH_TABLE_BLOCK_TYPE::NextUnoccupied(slot_offset_t from, slot_offset_t end) const {
+  while (from < end) {
+    size_t num_bits;
+    uint64_t free_bits = ~LoadBits(occupied_, from, &num_bits);
+    if (num_bits < 64) {
+      free_bits &= (uint64_t{1} << num_bits) - 1;
+    }
+    if (free_bits != 0) {
+      return std::min<slot_offset_t>(from + __builtin_ctzll(free_bits), end);
+    }
+    from += num_bits;
+  }
+  return end;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+slot_offset_t HASH_TABLE_BLOCK_TYPE::NextReadable(slot_offset_t from, slot_offset_t end) const {
+  while (from < end) {
+    size_t num_bits;
+    uint64_t readable_bits = LoadBits(readable_, from, &num_bits);
+    if (readable_bits != 0) {
+      return std::min<slot_offset_t>(from + __builtin_ctzll(readable_bits), end);
+    }
+    from += num_bits;
+  }
+  return end;
 }
 
 // DO NOT REMOVE ANYTHING BELOW THIS LINE
@@ -13,8 +13,10 @@
 #include "storage/page/hash_table_header_page.h"
 
 namespace bustub {
-page_id_t HashTableHeaderPage::GetBlockPageId(size_t index) { 
-    if(index<size_)return block_page_ids_[index];
+static_assert(sizeof(HashTableHeaderPage) == 32, "The header page fields take 32 bytes, see the layout.");
+
+page_id_t HashTableHeaderPage::GetBlockPageId(size_t index) const { 
+    if(index<next_ind_)return block_page_ids_[index];
     return 0; 
 }
 
@@ -41,14 +43,13 @@ void HashTableHeaderPage::AddBlockPageId(page_id_t page_id) {
     next_ind_++;
 }
 
-size_t HashTableHeaderPage::NumBlocks() { 
+size_t HashTableHeaderPage::NumBlocks() const { 
     if(next_ind_)return next_ind_;
     return 0; 
 }
 
 void HashTableHeaderPage::SetSize(size_t size) {
     size_ = size;
-    memset(block_page_ids_, 0, size);
 }
 
 size_t HashTableHeaderPage::GetSize() const { 
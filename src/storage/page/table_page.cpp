@@ -13,6 +13,7 @@
 #include "storage/page/table_page.h"
 
 #include <cassert>
+#include <memory>
 
 namespace bustub {
 
@@ -304,6 +305,39 @@ bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMan
   return true;
 }
 
+bool TablePage::GetTupleOptimistic(const RID &rid, Tuple *tuple) {
+  uint32_t slot_num = rid.GetSlotNum();
+  std::unique_ptr<char[]> data;
+  uint32_t size = 0;
+  bool found = OptimisticRead([&] {
+    // The page may be halfway through a write, so check every offset and size before following it.
+    if (slot_num >= GetTupleCount() || OFFSET_TUPLE_SIZE + SIZE_TUPLE * slot_num + sizeof(uint32_t) > PAGE_SIZE) {
+      return false;
+    }
+    uint32_t tuple_size = GetTupleSize(slot_num);
+    uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
+    if (IsDeleted(tuple_size) || tuple_offset > PAGE_SIZE || tuple_size > PAGE_SIZE - tuple_offset) {
+      return false;
+    }
+    data.reset(new char[tuple_size]);
+    memcpy(data.get(), GetData() + tuple_offset, tuple_size);
+    size = tuple_size;
+    return true;
+  });
+  if (!found) {
+    return false;
+  }
+
+  tuple->size_ = size;
+  if (tuple->allocated_) {
+    delete[] tuple->data_;
+  }
+  tuple->data_ = data.release();
+  tuple->rid_ = rid;
+  tuple->allocated_ = true;
+  return true;
+}
+
 bool TablePage::GetFirstTupleRid(RID *first_rid) {
   // Find and return the first valid tuple.
   for (uint32_t i = 0; i < GetTupleCount(); ++i) {
@@ -10,14 +10,22 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
+#include <utility>
 
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             std::shared_ptr<BufferAccessStrategy> strategy)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn), strategy_(std::move(strategy)) {
+  if (strategy_ != nullptr) {
+    // TableHeap::Begin has already prefetched the first stretch of the table.
+    pages_until_prefetch_ = std::max<size_t>(1, strategy_->GetPrefetchDepth() / 2);
+  }
   if (rid.GetPageId() != INVALID_PAGE_ID) {
     table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
   }
@@ -35,19 +43,29 @@ Tuple *TableIterator::operator->() {
 
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr);  // all pages are pinned
+  ReadPageGuard cur_guard = buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId(), strategy_.get());
+  if (!cur_guard.IsValid()) {
+    return Abort();
+  }
+  auto cur_page = static_cast<TablePage *>(cur_guard.GetPage());
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  &next_tuple_rid)) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
+      // Pin the next page before letting go of the current one, but only latch it afterwards.
+      BasicPageGuard next_guard = buffer_pool_manager->FetchPageBasic(cur_page->GetNextPageId(), strategy_.get());
+      cur_guard.Drop();
+      cur_guard = next_guard.UpgradeRead();
+      if (!cur_guard.IsValid()) {
+        return Abort();
+      }
+      cur_page = static_cast<TablePage *>(cur_guard.GetPage());
+      // Keep the read-ahead half a prefetch window in front of the scan.
+      if (strategy_ != nullptr && --pages_until_prefetch_ == 0) {
+        table_heap_->PrefetchPages(cur_page->GetNextPageId(), strategy_);
+        pages_until_prefetch_ = std::max<size_t>(1, strategy_->GetPrefetchDepth() / 2);
+      }
       if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
         break;
       }
@@ -56,11 +74,18 @@ TableIterator &TableIterator::operator++() {
   tuple_->rid_ = next_tuple_rid;
 
   if (*this != table_heap_->End()) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+    // Read the tuple from the page we already hold rather than fetching it again through the shared pool.
+    cur_page->GetTuple(tuple_->rid_, tuple_, txn_, table_heap_->lock_manager_);
+  }
+  // cur_guard releases the page now that the tuple has been copied out
+  return *this;
+}
+
+TableIterator &TableIterator::Abort() {
+  if (txn_ != nullptr) {
+    txn_->SetState(TransactionState::ABORTED);
   }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
+  tuple_->rid_ = RID();
   return *this;
 }
 
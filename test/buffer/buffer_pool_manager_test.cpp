@@ -11,8 +11,18 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "gtest/gtest.h"
 
 namespace bustub {
@@ -44,9 +54,10 @@ TEST(BufferPoolManagerTest, BinaryDataTest) {
   random_binary_data[PAGE_SIZE / 2] = '\0';
   random_binary_data[PAGE_SIZE - 1] = '\0';
 
-  // Scenario: Once we have a page, we should be able to read and write content.
-  std::strncpy(page0->GetData(), random_binary_data, PAGE_SIZE);
-  EXPECT_EQ(0, std::strcmp(page0->GetData(), random_binary_data));
+  // Scenario: Once we have a page, we should be able to read and write content after its header.
+  char *payload = page0->GetData() + Page::SIZE_PAGE_HEADER;
+  std::strncpy(payload, random_binary_data, PAGE_SIZE - Page::SIZE_PAGE_HEADER);
+  EXPECT_EQ(0, std::strcmp(payload, random_binary_data));
 
   // Scenario: We should be able to create new pages until we fill up the buffer pool.
   for (size_t i = 1; i < buffer_pool_size; ++i) {
@@ -70,7 +81,7 @@ TEST(BufferPoolManagerTest, BinaryDataTest) {
   }
   // Scenario: We should be able to fetch the data we wrote a while ago.
   page0 = bpm->FetchPage(0);
-  EXPECT_EQ(0, strcmp(page0->GetData(), random_binary_data));
+  EXPECT_EQ(0, strcmp(page0->GetData() + Page::SIZE_PAGE_HEADER, random_binary_data));
   EXPECT_EQ(true, bpm->UnpinPage(0, true));
 
   // Shutdown the disk manager and remove the temporary file we created.
@@ -137,4 +148,577 @@ TEST(BufferPoolManagerTest, SampleTest) {
   delete disk_manager;
 }
 
+// Misses drop the latch during I/O; check that concurrent fetchers never observe a half-loaded or stale page
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ConcurrentEvictionTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const int num_pages = 16;
+  const int num_threads = 8;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page-%d", page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid] {
+      unsigned int seed = tid;
+      for (int round = 0; round < 200; ++round) {
+        page_id_t page_id = rand_r(&seed) % num_pages;
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          // Every frame is pinned by another thread at the moment.
+          continue;
+        }
+        EXPECT_EQ(page_id, page->GetPageId());
+        // Rewrite the same contents so that the page is dirty and has to be written back on eviction.
+        page->WLatch();
+        EXPECT_EQ("page-" + std::to_string(page_id), std::string(page->GetData()));
+        snprintf(page->GetData(), PAGE_SIZE, "page-%d", page_id);
+        page->WUnlatch();
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// Hits pin pages without the latch; check that they never pin a frame whose new page is still being loaded over a
+// clean victim
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ConcurrentHitMissTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 2;
+  const int num_pages = 3;
+  const int num_threads = 8;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page-%d", page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    EXPECT_EQ(true, bpm->FlushPage(page_id));
+  }
+
+  // Pages are only read, so every victim is clean and misses reuse frames without writing anything back.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid] {
+      unsigned int seed = tid;
+      for (int round = 0; round < 20000; ++round) {
+        page_id_t page_id = rand_r(&seed) % num_pages;
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        page->RLatch();
+        EXPECT_EQ("page-" + std::to_string(page_id), std::string(page->GetData()));
+        page->RUnlatch();
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// A scan through a buffer access strategy only recycles its own ring, so it never evicts the hot set
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, BufferAccessStrategyTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 64;
+  const int hot_pages = 16;
+  const int scan_pages = 10 * buffer_pool_size;
+
+  auto *disk_manager = new DiskManager(db_name);
+  {
+    // Create the hot pages followed by the pages of a table ten times the size of the pool.
+    auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+    for (int i = 0; i < hot_pages + scan_pages; ++i) {
+      page_id_t page_id;
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+      EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    }
+    for (int i = 0; i < hot_pages + scan_pages; ++i) {
+      bpm->FlushPage(i);
+    }
+    delete bpm;
+  }
+
+  for (bool use_strategy : {true, false}) {
+    auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+    BufferAccessStrategy strategy(BufferAccessStrategy::BulkReadRingSize(buffer_pool_size));
+
+    // Dirty every hot page, so that evicting one of them shows up as a disk write.
+    for (page_id_t page_id = 0; page_id < hot_pages; ++page_id) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+      EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    }
+    int writes_before_scan = disk_manager->GetNumWrites();
+
+    for (page_id_t page_id = hot_pages; page_id < hot_pages + scan_pages; ++page_id) {
+      auto *page = use_strategy ? bpm->FetchPageWithStrategy(page_id, &strategy) : bpm->FetchPage(page_id);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+    }
+
+    if (use_strategy) {
+      EXPECT_EQ(writes_before_scan, disk_manager->GetNumWrites());
+    } else {
+      EXPECT_EQ(writes_before_scan + hot_pages, disk_manager->GetNumWrites());
+    }
+    delete bpm;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 32;
+  const int chain_pages = 12;
+  const size_t chain_length = 8;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  // Link the pages into a chain: the first bytes of every page hold the id of the page after it.
+  for (int i = 0; i < chain_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    page_id_t next_page_id = i + 1 < chain_pages ? page_id + 1 : INVALID_PAGE_ID;
+    memcpy(page->GetData(), &next_page_id, sizeof(page_id_t));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    bpm->FlushPage(page_id);
+  }
+  delete bpm;
+
+  bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  auto next_page_id = [](Page *page) { return *reinterpret_cast<page_id_t *>(page->GetData()); };
+  bpm->PrefetchPage(0, nullptr, chain_length, next_page_id);
+
+  // The pages are read by the background I/O thread.
+  for (int i = 0; i < 1000 && disk_manager->GetNumReads() < static_cast<int>(chain_length); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(static_cast<int>(chain_length), disk_manager->GetNumReads());
+
+  // The prefetched pages are resident and unpinned, so they can be fetched without any further reads.
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(chain_length); ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(static_cast<int>(chain_length), disk_manager->GetNumReads());
+
+  // The chain stops after chain_length pages.
+  ASSERT_NE(nullptr, bpm->FetchPage(chain_length));
+  EXPECT_EQ(static_cast<int>(chain_length) + 1, disk_manager->GetNumReads());
+  EXPECT_EQ(true, bpm->UnpinPage(chain_length, false));
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+TEST(BufferPoolManagerTest, BackgroundWriterTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const lsn_t page_lsn = 5;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager, log_manager);
+  enable_logging = true;
+
+  // Fill the pool with dirty, unpinned pages whose log records are not persistent yet.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    page->SetLSN(page_lsn);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  bpm->StartBackgroundWriter(1.0);
+
+  // Scenario: the WAL rule holds the pages back until the log has been flushed past their LSN.
+  std::this_thread::sleep_for(4 * bg_writer_interval);
+  EXPECT_EQ(0, disk_manager->GetNumWrites());
+  log_manager->SetPersistentLSN(page_lsn);
+  for (int i = 0; i < 1000 && disk_manager->GetNumWrites() < static_cast<int>(buffer_pool_size); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(static_cast<int>(buffer_pool_size), disk_manager->GetNumWrites());
+  bpm->StopBackgroundWriter();
+
+  // Scenario: every frame is clean now, so evicting all of them does not write anything.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+  EXPECT_EQ(static_cast<int>(buffer_pool_size), disk_manager->GetNumWrites());
+
+  // Scenario: the evicted pages were written in full.
+  for (page_id_t page_id = buffer_pool_size; page_id < static_cast<page_id_t>(2 * buffer_pool_size); ++page_id) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size); ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(page_lsn, page->GetLSN());
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  enable_logging = false;
+  delete bpm;
+  delete log_manager;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+TEST(BufferPoolManagerTest, FlushAllPagesTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  // Dirty every page but one, so that the flush has to write two runs of consecutive pages.
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    page_ids.push_back(page_id);
+  }
+  std::sort(page_ids.begin(), page_ids.end());
+  const page_id_t clean_page_id = page_ids[buffer_pool_size / 2];
+  EXPECT_EQ(true, bpm->FlushPage(clean_page_id));
+  int writes_before_flush = disk_manager->GetNumWrites();
+  for (page_id_t page_id : page_ids) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, page_id != clean_page_id));
+  }
+
+  // Scenario: only the dirty pages are written, and flushing again writes nothing.
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes_before_flush + static_cast<int>(buffer_pool_size) - 1, disk_manager->GetNumWrites());
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes_before_flush + static_cast<int>(buffer_pool_size) - 1, disk_manager->GetNumWrites());
+
+  // Scenario: the pages are still resident after the flush, and what is on disk matches them.
+  char data[PAGE_SIZE];
+  char expected[PAGE_SIZE];
+  for (page_id_t page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    disk_manager->ReadPage(page_id, data);
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(expected, data));
+    // Only the copy on disk carries a checksum.
+    EXPECT_EQ(0, memcmp(page->GetData() + Page::SIZE_PAGE_HEADER, data + Page::SIZE_PAGE_HEADER,
+                        PAGE_SIZE - Page::SIZE_PAGE_HEADER));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(static_cast<int>(buffer_pool_size), disk_manager->GetNumReads());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+// Frames come from one page-aligned arena and their page objects from a cache-line aligned side array
+TEST(BufferPoolManagerTest, FrameArenaTest) {
+  const std::string db_name = "test.db";
+  // Large enough for the arena to ask for huge pages.
+  const size_t buffer_pool_size = 1024;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  // Scenario: frames are page-aligned and page objects are cache-line aligned, so that neither straddles a boundary.
+  Page *pages = bpm->GetPages();
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(pages[i].GetData()) % PAGE_SIZE);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(&pages[i]) % CACHELINE_SIZE);
+    if (i > 0) {
+      EXPECT_EQ(pages[i - 1].GetData() + PAGE_SIZE, pages[i].GetData());
+    }
+  }
+
+  // Scenario: new pages start out zeroed, and the data survives eviction and a fetch.
+  page_id_t page_id;
+  auto *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+  char zeroes[PAGE_SIZE] = {0};
+  EXPECT_EQ(0, memcmp(zeroes, page->GetData(), PAGE_SIZE));
+  snprintf(page->GetData(), PAGE_SIZE, "Hello");
+  EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t temp_page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&temp_page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  }
+  page = bpm->FetchPage(page_id);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, strcmp("Hello", page->GetData()));
+  EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+// Resize grows and shrinks the pool in place; shrinking writes back and drops the pages of the retired frames
+TEST(BufferPoolManagerTest, ResizeTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  EXPECT_EQ(buffer_pool_size * BUFFER_POOL_MAX_GROWTH, bpm->GetMaxPoolSize());
+  EXPECT_EQ(false, bpm->Resize(0));
+  EXPECT_EQ(false, bpm->Resize(bpm->GetMaxPoolSize() + 1));
+
+  // Scenario: growing a full pool makes room for more pages.
+  std::vector<page_id_t> page_ids;
+  auto new_page = [&] {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    if (page != nullptr) {
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+      page_ids.push_back(page_id);
+    }
+    return page;
+  };
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, new_page());
+  }
+  EXPECT_EQ(nullptr, new_page());
+  EXPECT_EQ(true, bpm->Resize(2 * buffer_pool_size));
+  EXPECT_EQ(2 * buffer_pool_size, bpm->GetPoolSize());
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, new_page());
+  }
+  EXPECT_EQ(nullptr, new_page());
+
+  // Scenario: shrinking waits for the pages pinned in retired frames, then writes them back.
+  for (size_t i = 0; i < page_ids.size() - 1; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], true));
+  }
+  std::atomic<bool> resized{false};
+  std::thread resizer([&] {
+    EXPECT_EQ(true, bpm->Resize(buffer_pool_size / 2));
+    resized = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(false, resized.load());
+  EXPECT_EQ(true, bpm->UnpinPage(page_ids.back(), true));
+  resizer.join();
+  EXPECT_EQ(buffer_pool_size / 2, bpm->GetPoolSize());
+
+  // Scenario: only the remaining frames can be pinned, and every page is still intact.
+  std::vector<Page *> pinned;
+  for (page_id_t page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    if (pinned.size() == buffer_pool_size / 2) {
+      EXPECT_EQ(nullptr, page);
+      break;
+    }
+    ASSERT_NE(nullptr, page);
+    pinned.push_back(page);
+  }
+  for (auto *page : pinned) {
+    EXPECT_EQ(true, bpm->UnpinPage(page->GetPageId(), false));
+  }
+  char expected[PAGE_SIZE];
+  for (page_id_t page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_GT(bpm->GetPoolSize(), static_cast<size_t>(page - bpm->GetPages()));
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(expected, page->GetData()));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: resizing while other threads fetch pages.
+  std::atomic<bool> done{false};
+  std::vector<std::thread> fetchers;
+  for (int t = 0; t < 4; ++t) {
+    fetchers.emplace_back([&, t] {
+      for (size_t i = t; !done; ++i) {
+        page_id_t page_id = page_ids[i % page_ids.size()];
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        char data[PAGE_SIZE];
+        snprintf(data, PAGE_SIZE, "page %d", page_id);
+        EXPECT_EQ(0, strcmp(data, page->GetData()));
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, i % 3 == 0));
+      }
+    });
+  }
+  for (size_t size : {12, 5, 32, 6, 9}) {
+    EXPECT_EQ(true, bpm->Resize(size));
+  }
+  done = true;
+  for (auto &fetcher : fetchers) {
+    fetcher.join();
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+// GetStats counts hits, misses and evictions and reports the state of the frames
+TEST(BufferPoolManagerTest, StatsTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    page_ids.push_back(page_id);
+  }
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(buffer_pool_size, stats.pool_size_);
+  EXPECT_EQ(buffer_pool_size, stats.resident_pages_);
+  EXPECT_EQ(0, stats.free_frames_);
+  EXPECT_EQ(buffer_pool_size, stats.dirty_pages_);
+  EXPECT_EQ(0, stats.hits_ + stats.misses_ + stats.evictions_);
+
+  // Scenario: a resident page is a hit; a new page evicts a dirty page, which is written back.
+  ASSERT_NE(nullptr, bpm->FetchPage(page_ids[0]));
+  EXPECT_EQ(true, bpm->UnpinPage(page_ids[0], false));
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  page_ids.push_back(page_id);
+  stats = bpm->GetStats();
+  EXPECT_EQ(1, stats.hits_);
+  EXPECT_EQ(0, stats.misses_);
+  EXPECT_EQ(1, stats.evictions_);
+  EXPECT_EQ(1, stats.dirty_evictions_);
+  EXPECT_EQ(1, stats.write_latency_.count_);
+
+  // Scenario: fetching every page again misses exactly once per page that is not resident.
+  for (page_id_t id : page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(id));
+    EXPECT_EQ(true, bpm->UnpinPage(id, false));
+  }
+  stats = bpm->GetStats();
+  EXPECT_EQ(1 + page_ids.size(), stats.hits_ + stats.misses_);
+  EXPECT_LE(1, stats.misses_);
+  EXPECT_EQ(stats.misses_, stats.read_latency_.count_);
+  EXPECT_EQ(stats.evictions_, stats.misses_ + 1);
+  EXPECT_NE(std::string::npos, stats.ToString().find("hits="));
+
+  // Scenario: the statistics dump can be started and stopped.
+  stats_dump_interval = std::chrono::milliseconds(10);
+  bpm->StartStatsDump();
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  bpm->StopStatsDump();
+
+  // Scenario: latencies land in power-of-two microsecond buckets.
+  EXPECT_EQ(0, LatencyHistogram::BucketOf(999));
+  EXPECT_EQ(1, LatencyHistogram::BucketOf(1000));
+  EXPECT_EQ(2, LatencyHistogram::BucketOf(2000));
+  EXPECT_EQ(LatencyHistogram::NUM_BUCKETS - 1, LatencyHistogram::BucketOf(UINT64_MAX));
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+// A page that fails its checksum on the way in is not served; the fetch fails and the frame is freed
+TEST(BufferPoolManagerTest, ChecksumFailureTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const int num_pages = 3;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData() + Page::SIZE_PAGE_HEADER, PAGE_SIZE - Page::SIZE_PAGE_HEADER, "page %d", page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+
+  // Flip a bit of page 1. Page p is preceded by the first free-space map, so it starts at (p + 1) * PAGE_SIZE.
+  int fd = open(db_name.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  char byte;
+  ASSERT_EQ(1, pread(fd, &byte, 1, 2 * PAGE_SIZE + 100));
+  byte ^= 1;
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, 2 * PAGE_SIZE + 100));
+  close(fd);
+
+  // Scenario: the corrupt page cannot be fetched, by pointer or by guard, and it does not stay resident.
+  bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  EXPECT_EQ(nullptr, bpm->FetchPage(1));
+  EXPECT_FALSE(bpm->FetchPageRead(1).IsValid());
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(2, stats.checksum_failures_);
+  EXPECT_EQ(0, stats.resident_pages_);
+  EXPECT_EQ(buffer_pool_size, stats.free_frames_);
+
+  // Scenario: the intact pages are served as usual.
+  for (page_id_t page_id : {0, 2}) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData() + Page::SIZE_PAGE_HEADER));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
 }  // namespace bustub
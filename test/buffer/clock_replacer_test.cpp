@@ -59,4 +59,56 @@ TEST(ClockReplacerTest, SampleTest) {
   EXPECT_EQ(4, value);
 }
 
+TEST(ClockReplacerTest, ConcurrencyTest) {
+  const int num_threads = 8;
+  const int frames_per_thread = 64;
+  ClockReplacer clock_replacer(num_threads * frames_per_thread);
+
+  // Scenario: every thread repeatedly unpins and pins its own frames, ending with all of them unpinned.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&clock_replacer, tid] {
+      for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < frames_per_thread; ++i) {
+          frame_id_t frame_id = tid * frames_per_thread + i;
+          clock_replacer.Unpin(frame_id);
+          if (round % 2 == 0) {
+            clock_replacer.Pin(frame_id);
+          }
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_threads * frames_per_thread, clock_replacer.Size());
+
+  // Scenario: concurrent victims hand out every frame exactly once.
+  std::vector<std::vector<frame_id_t>> victims(num_threads);
+  threads.clear();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&clock_replacer, &victims, tid] {
+      frame_id_t frame_id;
+      while (clock_replacer.Victim(&frame_id)) {
+        victims[tid].push_back(frame_id);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::vector<bool> seen(num_threads * frames_per_thread, false);
+  for (const auto &thread_victims : victims) {
+    for (frame_id_t frame_id : thread_victims) {
+      EXPECT_FALSE(seen[frame_id]);
+      seen[frame_id] = true;
+    }
+  }
+  for (bool frame_seen : seen) {
+    EXPECT_TRUE(frame_seen);
+  }
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
 }  // namespace bustub
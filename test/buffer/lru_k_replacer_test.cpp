@@ -0,0 +1,167 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_replacer(7, 2);
+
+  // Scenario: access frames 1-6 once, and frame 1 a second time.
+  for (frame_id_t frame_id = 1; frame_id <= 6; ++frame_id) {
+    lru_replacer.Pin(frame_id);
+  }
+  lru_replacer.Pin(1);
+  for (frame_id_t frame_id = 1; frame_id <= 6; ++frame_id) {
+    lru_replacer.Unpin(frame_id);
+  }
+  EXPECT_EQ(6, lru_replacer.Size());
+
+  // Scenario: frames 2-6 have +inf backward distance and go first, oldest first access first.
+  // Frame 1 has been accessed twice and is evicted last.
+  int value;
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  EXPECT_EQ(3, lru_replacer.Size());
+
+  // Scenario: pin frame 5 again. It now has two accesses, and the more recent ones compared to frame 1.
+  lru_replacer.Pin(5);
+  EXPECT_EQ(2, lru_replacer.Size());
+  lru_replacer.Unpin(5);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+  EXPECT_FALSE(lru_replacer.Victim(&value));
+  EXPECT_EQ(0, lru_replacer.Size());
+
+  // Scenario: a removed frame loses its history and is not victimized.
+  lru_replacer.Pin(3);
+  lru_replacer.Unpin(3);
+  lru_replacer.Remove(3);
+  EXPECT_EQ(0, lru_replacer.Size());
+  EXPECT_FALSE(lru_replacer.Victim(&value));
+
+  // Scenario: a victim that is pinned again before the buffer pool claims it keeps its history, and so is still
+  // evicted after a frame accessed only once.
+  lru_replacer.Pin(0);
+  lru_replacer.Pin(0);
+  lru_replacer.Unpin(0);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(0, value);
+  lru_replacer.Pin(0);
+  lru_replacer.Unpin(0);
+  lru_replacer.Remove(2);
+  lru_replacer.Pin(2);
+  lru_replacer.Unpin(2);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+}
+
+/**
+ * Drives a replacer the way the buffer pool does for a pool of pool_size frames: a hot set of pages is looked up
+ * over and over while a sequential scan touches many cold pages once each.
+ * @return the hit rate of the hot set lookups
+ */
+static double HotSetHitRate(Replacer *replacer, size_t pool_size) {
+  const int hot_pages = static_cast<int>(pool_size / 2);
+  const int scan_pages = static_cast<int>(pool_size * 20);
+  std::unordered_map<int, frame_id_t> page_table;
+  std::vector<int> frame_pages(pool_size, -1);
+  frame_id_t next_free = 0;
+  auto access = [&](int page) {
+    bool hit = page_table.count(page) > 0;
+    frame_id_t frame_id;
+    if (hit) {
+      frame_id = page_table[page];
+    } else if (next_free < static_cast<frame_id_t>(pool_size)) {
+      frame_id = next_free++;
+    } else {
+      EXPECT_TRUE(replacer->Victim(&frame_id));
+      // The buffer pool forgets the frame's history once it has claimed the frame for another page.
+      replacer->Remove(frame_id);
+      page_table.erase(frame_pages[frame_id]);
+    }
+    page_table[page] = frame_id;
+    frame_pages[frame_id] = page;
+    replacer->Pin(frame_id);
+    replacer->Unpin(frame_id);
+    return hit;
+  };
+
+  // Warm up the hot set.
+  for (int round = 0; round < 2; ++round) {
+    for (int page = 0; page < hot_pages; ++page) {
+      access(page);
+    }
+  }
+  // Interleave the scan with hot set lookups.
+  int hits = 0;
+  int lookups = 0;
+  for (int i = 0; i < scan_pages; ++i) {
+    access(hot_pages + i);
+    int page = i % hot_pages;
+    hits += access(page) ? 1 : 0;
+    lookups++;
+  }
+  return static_cast<double>(hits) / lookups;
+}
+
+TEST(LRUKReplacerTest, SetEvictableTest) {
+  LRUKReplacer lru_replacer(7, 2);
+  lru_replacer.Pin(1);
+  lru_replacer.Pin(2);
+  lru_replacer.Unpin(1);
+  lru_replacer.Unpin(2);
+
+  // Holding a frame takes it out of the replacer without counting as an access.
+  lru_replacer.SetEvictable(1, false);
+  EXPECT_EQ(1, lru_replacer.Size());
+  lru_replacer.SetEvictable(1, true);
+  EXPECT_EQ(2, lru_replacer.Size());
+
+  // Frame 1 still has a single access, older than frame 2's, so it goes first.
+  int value;
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+}
+
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  const size_t pool_size = 64;
+  auto lru_k_replacer = std::make_unique<LRUKReplacer>(pool_size, 2);
+  auto clock_replacer = std::make_unique<ClockReplacer>(pool_size);
+
+  double lru_k_hit_rate = HotSetHitRate(lru_k_replacer.get(), pool_size);
+  double clock_hit_rate = HotSetHitRate(clock_replacer.get(), pool_size);
+
+  // Scan pages are only ever accessed once, so LRU-K always evicts them before the hot set.
+  EXPECT_DOUBLE_EQ(1.0, lru_k_hit_rate);
+  EXPECT_GT(lru_k_hit_rate, clock_hit_rate);
+}
+
+}  // namespace bustub
@@ -0,0 +1,177 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// mmap_buffer_pool_manager_test.cpp
+//
+// Identification: test/buffer/mmap_buffer_pool_manager_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/mmap_buffer_pool_manager.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/schema.h"
+#include "concurrency/transaction.h"
+#include "gtest/gtest.h"
+#include "storage/table/table_heap.h"
+
+namespace bustub {
+
+// Check that pages written through a regular buffer pool are served from the mapping by a read-only one.
+TEST(MmapBufferPoolManagerTest, SampleTest) {
+  const std::string db_name = "test.db";
+  const int num_pages = 20;
+  remove(db_name.c_str());
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(5, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "Page %d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+
+  disk_manager = new DiskManager(db_name, DiskIOMode::MMAP_READ_ONLY);
+  ASSERT_TRUE(disk_manager->IsMemoryMapped());
+  EXPECT_EQ(num_pages, disk_manager->GetMappedPageCount());
+  auto *mmap_bpm = new MmapBufferPoolManager(disk_manager);
+
+  // Scenario: fetched pages are views of the mapping, shared by every fetch of the same page.
+  char expected[PAGE_SIZE];
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = mmap_bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(disk_manager->GetMappedPage(i), page->GetData());
+    snprintf(expected, PAGE_SIZE, "Page %d", i);
+    EXPECT_EQ(0, strcmp(expected, page->GetData()));
+    EXPECT_EQ(page, mmap_bpm->FetchPage(i));
+    EXPECT_EQ(2, page->GetPinCount());
+  }
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_EQ(true, mmap_bpm->UnpinPage(i, false));
+    EXPECT_EQ(true, mmap_bpm->UnpinPage(i, false));
+    EXPECT_EQ(false, mmap_bpm->UnpinPage(i, false));
+  }
+
+  // Scenario: the synchronous read path copies from the mapping, too.
+  char buf[PAGE_SIZE];
+  disk_manager->ReadPage(3, buf);
+  EXPECT_EQ(0, strcmp("Page 3", buf));
+
+  // Scenario: pages beyond the file cannot be fetched, and nothing can be created or deleted.
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, mmap_bpm->FetchPage(num_pages));
+  EXPECT_EQ(nullptr, mmap_bpm->NewPage(&page_id));
+  EXPECT_EQ(false, mmap_bpm->DeletePage(0));
+  EXPECT_EQ(false, mmap_bpm->Resize(1));
+
+  BufferPoolStats stats = mmap_bpm->GetStats();
+  EXPECT_EQ(2 * num_pages, stats.hits_);
+  EXPECT_EQ(0, stats.misses_);
+  EXPECT_EQ(num_pages, stats.resident_pages_);
+
+  delete mmap_bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove(db_name.c_str());
+}
+
+// Check that a page that fails its checksum is not served from the mapping.
+TEST(MmapBufferPoolManagerTest, ChecksumFailureTest) {
+  const std::string db_name = "test.db";
+  remove(db_name.c_str());
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(5, disk_manager);
+  for (int i = 0; i < 3; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+
+  // Flip a bit of page 1. Page p is preceded by the first free-space map, so it starts at (p + 1) * PAGE_SIZE.
+  int fd = open(db_name.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  char byte;
+  ASSERT_EQ(1, pread(fd, &byte, 1, 2 * PAGE_SIZE + 100));
+  byte ^= 1;
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, 2 * PAGE_SIZE + 100));
+  close(fd);
+
+  disk_manager = new DiskManager(db_name, DiskIOMode::MMAP_READ_ONLY);
+  auto *mmap_bpm = new MmapBufferPoolManager(disk_manager);
+  EXPECT_EQ(nullptr, mmap_bpm->FetchPage(1));
+  EXPECT_FALSE(mmap_bpm->FetchPageRead(1).IsValid());
+  EXPECT_EQ(false, mmap_bpm->UnpinPage(1, false));
+  ASSERT_NE(nullptr, mmap_bpm->FetchPage(2));
+  EXPECT_EQ(true, mmap_bpm->UnpinPage(2, false));
+  EXPECT_EQ(1, mmap_bpm->GetStats().resident_pages_);
+
+  delete mmap_bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove(db_name.c_str());
+}
+
+// Check that a table written through a regular buffer pool can be scanned through a read-only one.
+TEST(MmapBufferPoolManagerTest, TableScanTest) {
+  const std::string db_name = "test.db";
+  const int num_tuples = 2000;
+  remove(db_name.c_str());
+  Schema schema({Column{"a", TypeId::INTEGER}});
+  Transaction txn(0);
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(10, disk_manager);
+  auto *table = new TableHeap(bpm, nullptr, nullptr, &txn);
+  page_id_t first_page_id = table->GetFirstPageId();
+  for (int i = 0; i < num_tuples; ++i) {
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(Tuple({Value(TypeId::INTEGER, i)}, &schema), &rid, &txn));
+  }
+  bpm->FlushAllPages();
+  delete table;
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+
+  disk_manager = new DiskManager(db_name, DiskIOMode::MMAP_READ_ONLY);
+  auto *mmap_bpm = new MmapBufferPoolManager(disk_manager);
+  table = new TableHeap(mmap_bpm, nullptr, nullptr, first_page_id);
+  int count = 0;
+  for (auto it = table->Begin(&txn); it != table->End(); ++it) {
+    EXPECT_EQ(count, it->GetValue(&schema, 0).GetAs<int32_t>());
+    count++;
+  }
+  EXPECT_EQ(num_tuples, count);
+
+  delete table;
+  delete mmap_bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  remove(db_name.c_str());
+  remove("test.log");
+}
+
+}  // namespace bustub
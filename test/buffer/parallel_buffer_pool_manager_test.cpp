@@ -0,0 +1,226 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// parallel_buffer_pool_manager_test.cpp
+//
+// Identification: test/buffer/parallel_buffer_pool_manager_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/parallel_buffer_pool_manager.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, SampleTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 5;
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+  EXPECT_EQ(num_instances * buffer_pool_size, bpm->GetPoolSize());
+
+  page_id_t page_id_temp;
+  auto *page0 = bpm->NewPage(&page_id_temp);
+
+  // Scenario: The buffer pool is empty. We should be able to create a new page.
+  ASSERT_NE(nullptr, page0);
+  EXPECT_EQ(0, page_id_temp);
+
+  // Scenario: Once we have a page, we should be able to read and write content.
+  snprintf(page0->GetData(), PAGE_SIZE, "Hello");
+  EXPECT_EQ(0, strcmp(page0->GetData(), "Hello"));
+
+  // Scenario: New pages are handed out round-robin, and each page id maps back to the shard that created it.
+  std::vector<page_id_t> page_ids{page_id_temp};
+  for (size_t i = 1; i < num_instances * buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(i % num_instances, static_cast<size_t>(page_id_temp) % num_instances);
+    page_ids.push_back(page_id_temp);
+  }
+
+  // Scenario: Once every shard is full, we should not be able to create any new pages.
+  for (size_t i = 0; i < num_instances; ++i) {
+    EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  }
+
+  // Scenario: Freeing frames in a single shard is enough for NewPage to succeed again.
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i * num_instances], true));
+  }
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(0, page_id_temp % num_instances);
+  }
+
+  // Scenario: We should be able to fetch the data we wrote a while ago.
+  page0 = bpm->FetchPage(0);
+  ASSERT_NE(nullptr, page0);
+  EXPECT_EQ(0, strcmp(page0->GetData(), "Hello"));
+
+  // Scenario: If we unpin page 0 and then make a new page, all the buffer pages should
+  // now be pinned. Fetching page 0 should fail.
+  EXPECT_EQ(true, bpm->UnpinPage(0, true));
+  EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(nullptr, bpm->FetchPage(0));
+
+  // Shutdown the disk manager and remove the temporary file we created.
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, ConcurrencyTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 4;
+  const size_t buffer_pool_size = 8;
+  const int num_threads = 8;
+  const int num_pages = 64;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  // Write every page once, leaving it unpinned so that later fetches have to evict.
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid] {
+      for (int round = 0; round < 50; ++round) {
+        page_id_t page_id = (tid + round * num_threads) % num_pages;
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        page->RLatch();
+        EXPECT_EQ(std::to_string(page_id), std::string(page->GetData()));
+        page->RUnlatch();
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+TEST(ParallelBufferPoolManagerTest, FlushAllPagesTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 20;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(4, buffer_pool_size / 4, disk_manager);
+  // Dirty every page but one, so that the flush has to write two runs of consecutive pages.
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    page_ids.push_back(page_id);
+  }
+  std::sort(page_ids.begin(), page_ids.end());
+  const page_id_t clean_page_id = page_ids[buffer_pool_size / 2];
+  EXPECT_EQ(true, bpm->FlushPage(clean_page_id));
+  int writes_before_flush = disk_manager->GetNumWrites();
+  for (page_id_t page_id : page_ids) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, page_id != clean_page_id));
+  }
+
+  // Scenario: only the dirty pages are written, and flushing again writes nothing.
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes_before_flush + static_cast<int>(buffer_pool_size) - 1, disk_manager->GetNumWrites());
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes_before_flush + static_cast<int>(buffer_pool_size) - 1, disk_manager->GetNumWrites());
+
+  // Scenario: the pages are still resident after the flush, and what is on disk matches them.
+  char data[PAGE_SIZE];
+  char expected[PAGE_SIZE];
+  for (page_id_t page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    disk_manager->ReadPage(page_id, data);
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(expected, data));
+    // Only the copy on disk carries a checksum.
+    EXPECT_EQ(0, memcmp(page->GetData() + Page::SIZE_PAGE_HEADER, data + Page::SIZE_PAGE_HEADER,
+                        PAGE_SIZE - Page::SIZE_PAGE_HEADER));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(static_cast<int>(buffer_pool_size), disk_manager->GetNumReads());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+// Resizing a parallel pool spreads the new size over its shards
+TEST(ParallelBufferPoolManagerTest, ResizeTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, 2, disk_manager);
+  EXPECT_EQ(num_instances * 2 * BUFFER_POOL_MAX_GROWTH, bpm->GetMaxPoolSize());
+  EXPECT_EQ(false, bpm->Resize(num_instances - 1));
+  EXPECT_EQ(false, bpm->Resize(bpm->GetMaxPoolSize() + 1));
+
+  EXPECT_EQ(true, bpm->Resize(14));
+  EXPECT_EQ(14, bpm->GetPoolSize());
+  size_t total = 0;
+  for (page_id_t i = 0; i < static_cast<page_id_t>(num_instances); ++i) {
+    size_t shard_size = bpm->GetBufferPoolManager(i)->GetPoolSize();
+    EXPECT_TRUE(shard_size == 3 || shard_size == 4);
+    total += shard_size;
+  }
+  EXPECT_EQ(14, total);
+
+  // Scenario: every frame of the resized pool can hold a page.
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < 14; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    page_ids.push_back(page_id);
+  }
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  for (page_id_t id : page_ids) {
+    EXPECT_EQ(true, bpm->UnpinPage(id, true));
+  }
+  EXPECT_EQ(true, bpm->Resize(num_instances));
+  EXPECT_EQ(num_instances, bpm->GetPoolSize());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -48,4 +48,51 @@ TEST(CatalogTest, CreateTableTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(CatalogTest, TablespacePerTableTest) {
+  auto disk_manager = new DiskManager("catalog_test.db");
+  auto bpm = new BufferPoolManager(32, disk_manager);
+  auto catalog = new SimpleCatalog(bpm, nullptr, nullptr, disk_manager);
+  auto txn = new Transaction(0);
+
+  std::vector<Column> columns;
+  columns.emplace_back("A", TypeId::INTEGER);
+  Schema schema(columns);
+
+  // Each table gets a tablespace of its own, whose file holds the table's pages.
+  auto *potato = catalog->CreateTable(txn, "potato", schema);
+  auto *tomato = catalog->CreateTable(txn, "tomato", schema);
+  EXPECT_EQ(potato, catalog->GetTable("potato"));
+  EXPECT_TRUE(disk_manager->HasTablespace(potato->oid_ + 1));
+  EXPECT_TRUE(disk_manager->HasTablespace(tomato->oid_ + 1));
+
+  RID rid;
+  Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(42)}, &schema};
+  ASSERT_TRUE(tomato->table_->InsertTuple(tuple, &rid, txn));
+  EXPECT_EQ(tomato->oid_ + 1, DiskManager::GetTablespace(rid.GetPageId()));
+  Tuple result;
+  ASSERT_TRUE(tomato->table_->GetTuple(rid, &result, txn));
+  EXPECT_EQ(42, result.GetValue(&schema, 0).GetAs<int32_t>());
+
+  // A table whose tablespace is taken, here by a table of another catalog, lives in the main tablespace.
+  SimpleCatalog other_catalog(bpm, nullptr, nullptr, disk_manager);
+  auto *carrot = other_catalog.CreateTable(txn, "carrot", schema);
+  EXPECT_EQ(carrot, other_catalog.GetTable("carrot"));
+  ASSERT_TRUE(carrot->table_->InsertTuple(tuple, &rid, txn));
+  EXPECT_EQ(DiskManager::MAIN_TABLESPACE, DiskManager::GetTablespace(rid.GetPageId()));
+  bpm->FlushAllPages();
+
+  disk_manager->ShutDown();
+  for (auto *table : {potato, tomato}) {
+    std::string file_name = "catalog_test." + std::to_string(table->oid_ + 1) + ".db";
+    EXPECT_EQ(0, remove(file_name.c_str()));
+  }
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+  delete txn;
+  delete catalog;
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
@@ -111,4 +111,41 @@ TEST(HashTablePageTest, BlockPageSampleTest) {
   delete bpm;
 }
 
+// NOLINTNEXTLINE
+TEST(HashTablePageTest, BlockPageScanTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManager(5, disk_manager);
+
+  page_id_t block_page_id = INVALID_PAGE_ID;
+  auto block_page =
+      reinterpret_cast<HashTableBlockPage<int, int, IntComparator> *>(bpm->NewPage(&block_page_id, nullptr)->GetData());
+  using KeyType = int;
+  using ValueType = int;
+  slot_offset_t size = BLOCK_ARRAY_SIZE;
+
+  // occupy a run that spans several bitmap words, and leave tombstones in it
+  for (unsigned i = 3; i < 200; i++) {
+    block_page->Insert(i, i, i);
+    if (i < 150) {
+      block_page->Remove(i);
+    }
+  }
+  block_page->Insert(size - 1, 0, 0);
+
+  EXPECT_EQ(0, block_page->NextUnoccupied(0, size));
+  EXPECT_EQ(200, block_page->NextUnoccupied(3, size));
+  EXPECT_EQ(100, block_page->NextUnoccupied(3, 100));
+  EXPECT_EQ(size, block_page->NextUnoccupied(size - 1, size));
+  EXPECT_EQ(150, block_page->NextReadable(0, size));
+  EXPECT_EQ(170, block_page->NextReadable(170, size));
+  EXPECT_EQ(120, block_page->NextReadable(0, 120));
+  EXPECT_EQ(size - 1, block_page->NextReadable(200, size));
+
+  bpm->UnpinPage(block_page_id, true, nullptr);
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
 }  // namespace bustub
@@ -0,0 +1,152 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager_test.cpp
+//
+// Identification: test/storage/async_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <future>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/exception.h"
+#include "gtest/gtest.h"
+#include "storage/disk/async_disk_manager.h"
+
+namespace bustub {
+
+// Writes a batch of pages, reads them back with futures and callbacks, and checks the contents.
+static void ReadWriteBatch(AsyncDiskManager *dm) {
+  const size_t num_pages = 2 * AsyncDiskManager::QUEUE_DEPTH + 10;
+  std::vector<char> pages(num_pages * PAGE_SIZE);
+  for (size_t i = 0; i < num_pages; ++i) {
+    snprintf(&pages[i * PAGE_SIZE], PAGE_SIZE, "Page %zu", i);
+  }
+
+  // Scenario: a batch larger than the queue depth is written; every callback runs before Drain returns.
+  std::atomic<size_t> written{0};
+  std::vector<AsyncDiskManager::IORequest> requests;
+  for (size_t i = 0; i < num_pages; ++i) {
+    requests.push_back({static_cast<page_id_t>(i), &pages[i * PAGE_SIZE], true, [&](bool success) {
+                          EXPECT_TRUE(success);
+                          written++;
+                        }});
+  }
+  dm->SubmitBatch(std::move(requests));
+  dm->Drain();
+  EXPECT_EQ(num_pages, written);
+  EXPECT_EQ(static_cast<int>(num_pages), dm->GetNumWrites());
+
+  // Scenario: pages are read back through futures.
+  std::vector<char> buf(num_pages * PAGE_SIZE);
+  std::vector<std::future<bool>> reads;
+  for (size_t i = 0; i < num_pages; ++i) {
+    reads.push_back(dm->ReadPageAsync(static_cast<page_id_t>(i), &buf[i * PAGE_SIZE]));
+  }
+  for (auto &read : reads) {
+    EXPECT_TRUE(read.get());
+  }
+  // The pages read back carry the checksums stamped when they were written.
+  for (size_t i = 0; i < num_pages; ++i) {
+    DiskManager::StampChecksum(static_cast<page_id_t>(i), &pages[i * PAGE_SIZE]);
+  }
+  EXPECT_EQ(0, memcmp(pages.data(), buf.data(), pages.size()));
+
+  // Scenario: the asynchronous and synchronous interfaces see each other's writes.
+  char page[PAGE_SIZE] = {0};
+  char other[PAGE_SIZE] = {0};
+  char *payload = other + Page::SIZE_PAGE_HEADER;
+  strncpy(payload, "Overwritten", PAGE_SIZE - Page::SIZE_PAGE_HEADER);
+  EXPECT_TRUE(dm->WritePageAsync(1, other).get());
+  EXPECT_TRUE(dm->ReadPage(1, page));
+  EXPECT_EQ(0, strcmp("Overwritten", page + Page::SIZE_PAGE_HEADER));
+  strncpy(payload, "Written synchronously", PAGE_SIZE - Page::SIZE_PAGE_HEADER);
+  dm->WritePage(2, other);
+  std::atomic<bool> read{false};
+  dm->ReadPageAsync(2, page, [&](bool success) { read = success; });
+  dm->Drain();
+  EXPECT_TRUE(read);
+  EXPECT_EQ(0, strcmp("Written synchronously", page + Page::SIZE_PAGE_HEADER));
+
+  // Scenario: a page whose checksum does not match fails its read.
+  memset(page, 0, PAGE_SIZE);
+  page[PAGE_SIZE - 1] = 'x';
+  dm->WritePage(3, page);
+  // Page 3 lies behind the first free-space map and pages 0 to 2; flip its last byte.
+  int fd = open("test.db", O_WRONLY);
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(1, pwrite(fd, "y", 1, 4 * PAGE_SIZE + PAGE_SIZE - 1));
+  close(fd);
+  EXPECT_FALSE(dm->ReadPageAsync(3, page).get());
+  EXPECT_EQ(1, dm->GetNumChecksumFailures());
+
+  // Scenario: reading past the end of the file gives a zeroed page.
+  memset(page, 'x', PAGE_SIZE);
+  EXPECT_TRUE(dm->ReadPageAsync(num_pages + 5, page).get());
+  EXPECT_EQ(PAGE_SIZE, std::count(page, page + PAGE_SIZE, '\0'));
+
+  // Scenario: callbacks never run on the submitting thread, not even for buffers that are not page-aligned.
+  std::vector<char> unaligned(PAGE_SIZE + 1);
+  std::thread::id callback_thread;
+  dm->ReadPageAsync(2, unaligned.data() + 1, [&](bool success) {
+    EXPECT_TRUE(success);
+    callback_thread = std::this_thread::get_id();
+  });
+  dm->Drain();
+  EXPECT_NE(std::this_thread::get_id(), callback_thread);
+  EXPECT_EQ(0, strcmp("Written synchronously", unaligned.data() + 1 + Page::SIZE_PAGE_HEADER));
+
+  // Scenario: a batch naming a tablespace that is not open throws before any of its requests is queued, and the
+  // requests submitted afterwards still complete.
+  std::atomic<size_t> completed{0};
+  std::vector<AsyncDiskManager::IORequest> bad_batch;
+  bad_batch.push_back({1, page, false, [&](bool success) { completed++; }});
+  bad_batch.push_back({DiskManager::GetFirstPageId(5), other, false, [&](bool success) { completed++; }});
+  EXPECT_THROW(dm->SubmitBatch(std::move(bad_batch)), Exception);
+  dm->Drain();
+  EXPECT_EQ(0, completed);
+  EXPECT_TRUE(dm->ReadPageAsync(1, page).get());
+  EXPECT_EQ(0, strcmp("Overwritten", page + Page::SIZE_PAGE_HEADER));
+}
+
+// NOLINTNEXTLINE
+TEST(AsyncDiskManagerTest, IOUringTest) {
+  std::string db_file("test.db");
+  AsyncDiskManager dm(db_file);
+  ReadWriteBatch(&dm);
+  dm.ShutDown();
+  remove(db_file.c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(AsyncDiskManagerTest, DirectIOTest) {
+  std::string db_file("test.db");
+  AsyncDiskManager dm(db_file, DiskIOMode::DIRECT);
+  ReadWriteBatch(&dm);
+  dm.ShutDown();
+  remove(db_file.c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(AsyncDiskManagerTest, WorkerThreadTest) {
+  std::string db_file("test.db");
+  AsyncDiskManager dm(db_file, DiskIOMode::BUFFERED, false);
+  EXPECT_FALSE(dm.IsIOUringBacked());
+  ReadWriteBatch(&dm);
+  dm.ShutDown();
+  remove(db_file.c_str());
+}
+
+}  // namespace bustub
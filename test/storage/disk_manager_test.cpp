@@ -10,32 +10,60 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
+#include "common/util/crc32c.h"
+#include "common/util/lz4_codec.h"
 #include "gtest/gtest.h"
+#include "storage/disk/compressed_page_store.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
 
+// Counts the file descriptors open in this process.
+static size_t CountOpenFiles() {
+  size_t count = 0;
+  DIR *dir = opendir("/proc/self/fd");
+  while (readdir(dir) != nullptr) {
+    count++;
+  }
+  closedir(dir);
+  return count;
+}
+
 // NOLINTNEXTLINE
 TEST(DiskManagerTest, ReadWritePageTest) {
   char buf[PAGE_SIZE] = {0};
   char data[PAGE_SIZE] = {0};
   std::string db_file("test.db");
   auto dm = DiskManager(db_file);
-  std::strncpy(data, "A test string.", sizeof(data));
+  std::strncpy(data + Page::SIZE_PAGE_HEADER, "A test string.", sizeof(data) - Page::SIZE_PAGE_HEADER);
 
-  dm.ReadPage(0, buf);  // tolerate empty read
+  EXPECT_TRUE(dm.ReadPage(0, buf));  // tolerate empty read
 
+  // The page reads back as written, with its checksum stamped in the header.
   dm.WritePage(0, data);
-  dm.ReadPage(0, buf);
+  EXPECT_TRUE(dm.ReadPage(0, buf));
+  DiskManager::StampChecksum(0, data);
   EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
 
   std::memset(buf, 0, sizeof(buf));
   dm.WritePage(5, data);
-  dm.ReadPage(5, buf);
+  EXPECT_TRUE(dm.ReadPage(5, buf));
+  DiskManager::StampChecksum(5, data);
   EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  EXPECT_EQ(0, dm.GetNumChecksumFailures());
 
   dm.ShutDown();
   remove(db_file.c_str());
@@ -58,6 +86,513 @@ TEST(DiskManagerTest, ReadWriteLogTest) {
   remove(db_file.c_str());
 }
 
+// Direct I/O bypasses the page cache; unaligned buffers go through a bounce buffer
+TEST(DiskManagerTest, DirectIOTest) {
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file, DiskIOMode::DIRECT);
+  // An aligned and an unaligned page.
+  alignas(PAGE_SIZE) static char aligned[PAGE_SIZE];
+  static char unaligned_storage[PAGE_SIZE + 1];
+  char *unaligned = unaligned_storage + 1;
+  char buf[PAGE_SIZE] = {0};
+  // Payloads start after the page header, whose checksum field the disk manager fills in.
+  const size_t payload = Page::SIZE_PAGE_HEADER;
+  std::strncpy(aligned + payload, "An aligned page.", PAGE_SIZE - payload);
+  std::strncpy(unaligned + payload, "An unaligned page.", PAGE_SIZE - payload);
+
+  dm.ReadPage(3, buf);  // tolerate empty read
+  EXPECT_EQ(0, buf[0]);
+
+  dm.WritePage(0, aligned);
+  dm.WritePage(1, unaligned);
+  const char *run[] = {unaligned, aligned};
+  dm.WritePages(2, run, 2);
+  dm.SyncPages();
+  EXPECT_EQ(4, dm.GetNumWrites());
+
+  EXPECT_TRUE(dm.ReadPage(0, buf));
+  EXPECT_EQ(0, std::memcmp(buf + payload, aligned + payload, PAGE_SIZE - payload));
+  EXPECT_TRUE(dm.ReadPage(1, unaligned));
+  EXPECT_EQ(0, std::strcmp("An unaligned page.", unaligned + payload));
+  EXPECT_TRUE(dm.ReadPage(2, buf));
+  EXPECT_EQ(0, std::strcmp("An unaligned page.", buf + payload));
+  EXPECT_TRUE(dm.ReadPage(3, aligned));
+  EXPECT_EQ(0, std::strcmp("An aligned page.", aligned + payload));
+
+  // Scenario: a run of aligned pages is written with one write.
+  alignas(PAGE_SIZE) static char pages[2][PAGE_SIZE];
+  std::strncpy(pages[0], "Page 4.", PAGE_SIZE);
+  std::strncpy(pages[1], "Page 5.", PAGE_SIZE);
+  const char *aligned_run[] = {pages[0], pages[1]};
+  dm.WritePages(4, aligned_run, 2);
+  EXPECT_TRUE(dm.ReadPage(5, buf));
+  EXPECT_EQ(0, std::strcmp("Page 5.", buf));
+
+  dm.ShutDown();
+  remove(db_file.c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(DiskManagerTest, ConcurrentReadWriteTest) {
+  const int num_threads = 8;
+  const int pages_per_thread = 64;
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  // Every thread writes and reads back its own pages; some of them lie past the 4 GB mark of the (sparse) file.
+  const page_id_t far_page_id = static_cast<page_id_t>((int64_t{1} << 32) / PAGE_SIZE);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      char data[PAGE_SIZE] = {0};
+      char buf[PAGE_SIZE] = {0};
+      for (int i = 0; i < pages_per_thread; ++i) {
+        page_id_t page_id = t * pages_per_thread + i + (i % 2 == 0 ? 0 : far_page_id);
+        snprintf(data, sizeof(data), "Page %d", page_id);
+        dm.WritePage(page_id, data);
+        EXPECT_TRUE(dm.ReadPage(page_id, buf));
+        DiskManager::StampChecksum(page_id, data);
+        EXPECT_EQ(0, std::memcmp(buf, data, sizeof(buf)));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_threads * pages_per_thread, dm.GetNumWrites());
+
+  // Scenario: reading past the end of the file gives a zeroed page.
+  char buf[PAGE_SIZE];
+  std::memset(buf, 'x', sizeof(buf));
+  dm.ReadPage(far_page_id + num_threads * pages_per_thread, buf);
+  EXPECT_EQ(PAGE_SIZE, std::count(buf, buf + PAGE_SIZE, '\0'));
+
+  dm.ShutDown();
+  remove(db_file.c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(DiskManagerTest, AllocatePageTest) {
+  std::string db_file("test.db");
+  remove(db_file.c_str());
+  auto *dm = new DiskManager(db_file);
+  for (page_id_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, dm->AllocatePage());
+  }
+
+  // Scenario: freed pages are reused before the file grows; freeing twice is ignored.
+  dm->DeallocatePage(3);
+  dm->DeallocatePage(7);
+  dm->DeallocatePage(7);
+  EXPECT_FALSE(dm->IsAllocated(3));
+  EXPECT_EQ(7, dm->AllocatePage());
+  EXPECT_EQ(3, dm->AllocatePage());
+  EXPECT_EQ(10, dm->AllocatePage());
+
+  // Scenario: shards get page ids of their own residue; skipped ids stay free for the others.
+  EXPECT_EQ(13, dm->AllocatePage(4, 1));
+  EXPECT_EQ(12, dm->AllocatePage(4, 0));
+  EXPECT_EQ(11, dm->AllocatePage(4, 3));
+  EXPECT_EQ(14, dm->AllocatePage(4, 2));
+
+  // Scenario: an extent that would cross a free-space map starts after it; the skipped pages are reused later.
+  const auto per_map = static_cast<page_id_t>(DiskManager::PAGES_PER_MAP);
+  EXPECT_EQ(15, dm->AllocateExtent(per_map - 16));
+  EXPECT_EQ(per_map, dm->AllocateExtent(8));
+  EXPECT_EQ(per_map - 1, dm->AllocatePage(1, 0));
+
+  // Pages on both sides of the map keep their data.
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE] = {0};
+  for (page_id_t page_id : {per_map - 1, per_map}) {
+    snprintf(data, sizeof(data), "Page %d", page_id);
+    dm->WritePage(page_id, data);
+  }
+  const char *run[] = {data, data, data};
+  dm->WritePages(per_map - 2, run, 3);
+  dm->DeallocatePage(5);
+  dm->ShutDown();
+  delete dm;
+
+  // Scenario: the allocation state survives reopening the file.
+  dm = new DiskManager(db_file);
+  EXPECT_FALSE(dm->IsAllocated(5));
+  EXPECT_TRUE(dm->IsAllocated(6));
+  EXPECT_TRUE(dm->IsAllocated(per_map + 7));
+  EXPECT_FALSE(dm->IsAllocated(per_map + 8));
+  EXPECT_TRUE(dm->ReadPage(per_map - 2, buf));
+  DiskManager::StampChecksum(per_map - 2, data);
+  EXPECT_EQ(0, std::memcmp(buf, data, sizeof(buf)));
+  EXPECT_EQ(5, dm->AllocatePage());
+  EXPECT_EQ(per_map + 8, dm->AllocatePage());
+
+  // Scenario: the maps on disk are current without a ShutDown, so a crash neither loses an allocation nor frees a page.
+  dm->DeallocatePage(6);
+  EXPECT_EQ(6, dm->AllocatePage());
+  dm->DeallocatePage(8);
+  auto *reopened = new DiskManager(db_file);
+  EXPECT_TRUE(reopened->IsAllocated(5));
+  EXPECT_TRUE(reopened->IsAllocated(6));
+  EXPECT_FALSE(reopened->IsAllocated(8));
+  EXPECT_TRUE(reopened->IsAllocated(per_map + 8));
+  reopened->ShutDown();
+  delete reopened;
+
+  // Scenario: switching between moduli reuses freed pages without losing any.
+  dm->DeallocatePage(9);
+  dm->DeallocatePage(10);
+  EXPECT_EQ(9, dm->AllocatePage(2, 1));
+  EXPECT_EQ(10, dm->AllocatePage());
+  EXPECT_EQ(8, dm->AllocatePage(2, 0));
+  dm->ShutDown();
+  delete dm;
+  remove(db_file.c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(DiskManagerTest, ChecksumTest) {
+  // CRC-32C check value.
+  EXPECT_EQ(0xE3069283, Crc32c::Value("123456789", 9));
+  EXPECT_EQ(Crc32c::Value("123456789", 9), Crc32c::Extend(Crc32c::Value("1234", 4), "56789", 5));
+  // Long inputs are checksummed in interleaved streams; short pieces are not.
+  std::vector<char> bytes(3 * PAGE_SIZE + 5);
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    bytes[i] = static_cast<char>(i * 131 + 7);
+  }
+  uint32_t crc = 0;
+  for (size_t i = 0; i < bytes.size(); i += 100) {
+    crc = Crc32c::Extend(crc, bytes.data() + i, std::min<size_t>(100, bytes.size() - i));
+  }
+  EXPECT_EQ(crc, Crc32c::Value(bytes.data(), bytes.size()));
+
+  std::string db_file("test.db");
+  remove(db_file.c_str());
+  auto dm = DiskManager(db_file);
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE] = {0};
+  for (page_id_t page_id = 0; page_id < 4; ++page_id) {
+    snprintf(data + Page::SIZE_PAGE_HEADER, PAGE_SIZE - Page::SIZE_PAGE_HEADER, "Page %d", page_id);
+    dm.WritePage(page_id, data);
+  }
+  dm.SyncPages();
+
+  // Scenario: written pages and pages that were never written verify.
+  EXPECT_TRUE(dm.ReadPage(0, buf));
+  EXPECT_EQ(0, std::strcmp("Page 0", buf + Page::SIZE_PAGE_HEADER));
+  EXPECT_TRUE(DiskManager::VerifyChecksum(0, buf));
+  EXPECT_TRUE(dm.ReadPage(10, buf));
+
+  // Scenario: a flipped bit, a torn page and a page written in the wrong place all fail their checksum.
+  int fd = open(db_file.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  // Page p is preceded by the first free-space map, so it starts at (p + 1) * PAGE_SIZE.
+  auto offset = [](page_id_t page_id) { return (page_id + 1) * PAGE_SIZE; };
+  char byte;
+  ASSERT_EQ(1, pread(fd, &byte, 1, offset(1) + 100));
+  byte ^= 1;
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, offset(1) + 100));
+  ASSERT_EQ(PAGE_SIZE / 2, pwrite(fd, data, PAGE_SIZE / 2, offset(2) + PAGE_SIZE / 2));
+  ASSERT_EQ(PAGE_SIZE, pread(fd, buf, PAGE_SIZE, offset(0)));
+  ASSERT_EQ(PAGE_SIZE, pwrite(fd, buf, PAGE_SIZE, offset(3)));
+  close(fd);
+  EXPECT_FALSE(dm.ReadPage(1, buf));
+  EXPECT_FALSE(dm.ReadPage(2, buf));
+  EXPECT_FALSE(dm.ReadPage(3, buf));
+  EXPECT_EQ(3, dm.GetNumChecksumFailures());
+
+  dm.ShutDown();
+  remove(db_file.c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(DiskManagerTest, CompressedIOTest) {
+  // Scenario: blocks round-trip through the codec, including runs that copy from the bytes they produce.
+  std::vector<char> block(3 * PAGE_SIZE);
+  std::mt19937 random(17);
+  for (size_t i = 0; i < block.size(); ++i) {
+    block[i] = i < PAGE_SIZE ? 'a' : static_cast<char>(i < 2 * PAGE_SIZE ? i % 7 : random());
+  }
+  std::vector<char> compressed(block.size() + block.size() / 255 + 16);
+  std::vector<char> decompressed(block.size());
+  size_t length = Lz4Codec::Compress(block.data(), block.size(), compressed.data(), compressed.size());
+  ASSERT_GT(length, 0);
+  EXPECT_LT(length, 2 * PAGE_SIZE);
+  EXPECT_TRUE(Lz4Codec::Decompress(compressed.data(), length, decompressed.data(), decompressed.size()));
+  EXPECT_EQ(block, decompressed);
+  EXPECT_FALSE(Lz4Codec::Decompress(compressed.data(), length - 1, decompressed.data(), decompressed.size()));
+  EXPECT_FALSE(Lz4Codec::Decompress(compressed.data(), length, decompressed.data(), decompressed.size() - 1));
+  // Incompressible bytes do not fit into less space than they take.
+  EXPECT_EQ(0, Lz4Codec::Compress(block.data() + 2 * PAGE_SIZE, PAGE_SIZE, compressed.data(), PAGE_SIZE));
+
+  std::string db_file("test.db");
+  std::string store_file("test.pages");
+  remove(db_file.c_str());
+  remove(store_file.c_str());
+  auto *dm = new DiskManager(db_file, DiskIOMode::COMPRESSED);
+  EXPECT_TRUE(dm->IsCompressed());
+
+  // Scenario: table-like pages, rows of small integers with free space between the slot array and the rows, take
+  // a fraction of a page on disk and read back whole.
+  const page_id_t num_pages = 64;
+  auto fill_page = [](page_id_t page_id, char *data) {
+    std::memset(data, 0, PAGE_SIZE);
+    const uint32_t num_rows = 100;
+    for (uint32_t row = 0; row < num_rows; ++row) {
+      uint32_t slot[2] = {PAGE_SIZE - (row + 1) * 16, 16};
+      std::memcpy(data + 28 + row * sizeof(slot), slot, sizeof(slot));
+      int32_t columns[4] = {page_id, static_cast<int32_t>(row), static_cast<int32_t>(row % 10), 1000 + page_id};
+      std::memcpy(data + slot[0], columns, sizeof(columns));
+    }
+  };
+  char data[PAGE_SIZE];
+  char buf[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    EXPECT_EQ(page_id, dm->AllocatePage());
+    fill_page(page_id, data);
+    dm->WritePage(page_id, data);
+  }
+  EXPECT_LT(dm->GetPageBytesWritten(), num_pages * PAGE_SIZE / 2);
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    EXPECT_TRUE(dm->ReadPage(page_id, buf));
+    fill_page(page_id, data);
+    DiskManager::StampChecksum(page_id, data);
+    EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+  }
+  EXPECT_LT(dm->GetPageBytesRead(), num_pages * PAGE_SIZE / 2);
+
+  // Scenario: a page that grows moves to a larger slot, and a deallocated page reads as zeroes.
+  std::memcpy(data, block.data() + 2 * PAGE_SIZE, PAGE_SIZE);
+  dm->WritePage(3, data);
+  dm->DeallocatePage(5);
+  EXPECT_TRUE(dm->ReadPage(5, buf));
+  EXPECT_EQ(buf + PAGE_SIZE, std::find_if(buf, buf + PAGE_SIZE, [](char c) { return c != 0; }));
+  dm->ShutDown();
+  delete dm;
+
+  // Scenario: the page locations are rebuilt when the store is reopened.
+  dm = new DiskManager(db_file, DiskIOMode::COMPRESSED);
+  EXPECT_TRUE(dm->ReadPage(3, buf));
+  DiskManager::StampChecksum(3, data);
+  EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+  EXPECT_TRUE(dm->ReadPage(num_pages - 1, buf));
+  fill_page(num_pages - 1, data);
+  DiskManager::StampChecksum(num_pages - 1, data);
+  EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+  EXPECT_TRUE(dm->ReadPage(5, buf));
+  EXPECT_EQ(buf + PAGE_SIZE, std::find_if(buf, buf + PAGE_SIZE, [](char c) { return c != 0; }));
+  EXPECT_EQ(5, dm->AllocatePage());
+  EXPECT_EQ(num_pages, dm->AllocatePage());
+
+  // Scenario: a damaged slot fails the read. Page 0 was written first, into the first slot of the store.
+  int fd = open(store_file.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  char byte;
+  ASSERT_EQ(1, pread(fd, &byte, 1, 40));
+  byte ^= 1;
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, 40));
+  close(fd);
+  EXPECT_FALSE(dm->ReadPage(0, buf));
+  EXPECT_EQ(1, dm->GetNumChecksumFailures());
+
+  // Scenario: a rewritten page goes to a fresh slot, and the old slot keeps its copy until the store is synced. When
+  // a crash tears the new slot and leaves the old one, the old copy is read back after a restart.
+  auto find_slot = [&store_file](page_id_t page_id) {
+    int fd = open(store_file.c_str(), O_RDONLY);
+    int64_t found = -1;
+    uint32_t found_generation = 0;
+    uint32_t header[4];
+    for (int64_t offset = 0; pread(fd, header, sizeof(header), offset) == sizeof(header);
+         offset += CompressedPageStore::SLOT_UNIT) {
+      if (header[1] == static_cast<uint32_t>(page_id) && header[3] > found_generation) {
+        found = offset;
+        found_generation = header[3];
+      }
+    }
+    close(fd);
+    return found;
+  };
+  int64_t old_slot = find_slot(1);
+  ASSERT_GE(old_slot, 0);
+  uint32_t old_header[5];
+  fd = open(store_file.c_str(), O_RDWR);
+  ASSERT_EQ(sizeof(old_header), pread(fd, old_header, sizeof(old_header), old_slot));
+  fill_page(1, data);
+  data[PAGE_SIZE - 1] = 'x';
+  dm->WritePage(1, data);
+  int64_t new_slot = find_slot(1);
+  EXPECT_NE(old_slot, new_slot);
+  uint32_t header[5];
+  ASSERT_EQ(sizeof(header), pread(fd, header, sizeof(header), old_slot));
+  EXPECT_EQ(0, std::memcmp(old_header, header, sizeof(header)));
+  // Closing the store syncs it and frees the old slot; undo that and tear the new slot.
+  delete dm;
+  ASSERT_EQ(sizeof(old_header), pwrite(fd, old_header, sizeof(old_header), old_slot));
+  ASSERT_EQ(1, pread(fd, &byte, 1, new_slot + 40));
+  byte ^= 1;
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, new_slot + 40));
+  close(fd);
+  dm = new DiskManager(db_file, DiskIOMode::COMPRESSED);
+  EXPECT_TRUE(dm->ReadPage(1, buf));
+  fill_page(1, data);
+  DiskManager::StampChecksum(1, data);
+  EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+
+  dm->ShutDown();
+  delete dm;
+  remove(db_file.c_str());
+  remove(store_file.c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(DiskManagerTest, PageStoreSlotTest) {
+  std::string store_file("test_slots.pages");
+  remove(store_file.c_str());
+  auto file_size = [&store_file]() {
+    struct stat stat_buf;
+    return stat(store_file.c_str(), &stat_buf) == 0 ? static_cast<size_t>(stat_buf.st_size) : 0;
+  };
+  std::vector<char> raw(PAGE_SIZE);
+  std::mt19937 random(23);
+  std::generate(raw.begin(), raw.end(), [&random]() { return static_cast<char>(random()); });
+  std::vector<char> small(PAGE_SIZE, 'a');
+  std::vector<char> buf(PAGE_SIZE);
+  size_t bytes_read;
+
+  auto *store = new CompressedPageStore(store_file);
+  size_t raw_size = store->Write(0, raw.data());
+  size_t small_size = store->Write(1, small.data());
+  ASSERT_LT(small_size, raw_size);
+
+  // Scenario: a page rewritten over and over moves between two slots instead of growing the file.
+  for (int i = 0; i < 10; ++i) {
+    small[PAGE_SIZE - 1] = static_cast<char>('a' + i);
+    EXPECT_EQ(small_size, store->Write(1, small.data()));
+  }
+  EXPECT_LE(file_size(), raw_size + 2 * small_size);
+  size_t size_before_split = file_size();
+
+  // Scenario: a small page takes the front of a larger free slot, and the rest stays free.
+  store->Remove(0);
+  EXPECT_EQ(small_size, store->Write(2, small.data()));
+  EXPECT_EQ(size_before_split, file_size());
+  EXPECT_EQ(2 * small_size, store->GetStoredBytes());
+  store->Sync();
+  delete store;
+
+  // Scenario: the split slots are found again when the store is reopened.
+  store = new CompressedPageStore(store_file);
+  EXPECT_EQ(2 * small_size, store->GetStoredBytes());
+  for (page_id_t page_id : {1, 2}) {
+    EXPECT_TRUE(store->Read(page_id, buf.data(), &bytes_read));
+    EXPECT_EQ(small, buf);
+  }
+  EXPECT_TRUE(store->Read(0, buf.data(), &bytes_read));
+  EXPECT_EQ(0, bytes_read);
+  // The rest of the split slot is too small for a raw page, which goes to the end of the file.
+  EXPECT_EQ(raw_size, store->Write(3, raw.data()));
+  EXPECT_EQ(size_before_split + raw_size, file_size());
+  delete store;
+  remove(store_file.c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(DiskManagerTest, TablespaceTest) {
+  std::string db_file("test.db");
+  std::string directory("test_tablespaces");
+  remove(db_file.c_str());
+  mkdir(directory.c_str(), 0755);
+  auto *dm = new DiskManager(db_file);
+  EXPECT_EQ(0, dm->AllocatePage());
+
+  // Scenario: tablespaces have data files and page ids of their own, next to the database file or elsewhere.
+  EXPECT_THROW(dm->AllocatePage(1, 0, 2), Exception);
+  std::string file2 = dm->OpenTablespace(2);
+  std::string file3 = dm->OpenTablespace(3, directory);
+  EXPECT_EQ("test.2.db", file2);
+  EXPECT_EQ(directory + "/test.3.db", file3);
+  EXPECT_THROW(dm->OpenTablespace(3), Exception);
+  EXPECT_THROW(dm->OpenTablespace(DiskManager::MAX_TABLESPACES), Exception);
+  const page_id_t first2 = DiskManager::GetFirstPageId(2);
+  const page_id_t first3 = DiskManager::GetFirstPageId(3);
+  EXPECT_EQ(first2, dm->AllocateExtent(4, 2));
+  EXPECT_EQ(first3, dm->AllocatePage(1, 0, 3));
+  EXPECT_EQ(first3 + 1, dm->AllocatePage(1, 0, 3));
+  EXPECT_EQ(1, dm->AllocatePage());
+  EXPECT_EQ(3U, DiskManager::GetTablespace(first3 + 1));
+
+  // Scenario: the database file has more page ids than the other tablespaces, and page ids map back to their
+  // tablespace.
+  EXPECT_EQ(DiskManager::MAIN_TABLESPACE,
+            DiskManager::GetTablespace(static_cast<page_id_t>(DiskManager::PAGES_PER_TABLESPACE) + 5));
+  EXPECT_EQ(DiskManager::MAIN_TABLESPACE,
+            DiskManager::GetTablespace(static_cast<page_id_t>(DiskManager::MAIN_TABLESPACE_PAGES - 1)));
+  for (tablespace_id_t tablespace = 0; tablespace < DiskManager::MAX_TABLESPACES; ++tablespace) {
+    page_id_t first = DiskManager::GetFirstPageId(tablespace);
+    page_id_t last = first + static_cast<page_id_t>(DiskManager::GetTablespacePages(tablespace) - 1);
+    ASSERT_GE(last, first);
+    EXPECT_EQ(tablespace, DiskManager::GetTablespace(first));
+    EXPECT_EQ(tablespace, DiskManager::GetTablespace(last));
+  }
+
+  // Scenario: a data file reserves disk space ahead of its pages, without growing past its first free-space map.
+  struct stat stat_buf;
+  ASSERT_EQ(0, stat(file3.c_str(), &stat_buf));
+  EXPECT_EQ(PAGE_SIZE, stat_buf.st_size);
+  EXPECT_GE(stat_buf.st_blocks * 512, PREALLOCATE_PAGES * PAGE_SIZE);
+
+  // Scenario: pages are written to the file of their tablespace, where they are laid out as in the database file.
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE] = {0};
+  for (page_id_t page_id : {1, first2 + 3, first3 + 1}) {
+    snprintf(data + Page::SIZE_PAGE_HEADER, PAGE_SIZE - Page::SIZE_PAGE_HEADER, "Page %d", page_id);
+    dm->WritePage(page_id, data);
+  }
+  const char *run[] = {data, data};
+  dm->WritePages(first2, run, 2);
+  ASSERT_EQ(0, stat(db_file.c_str(), &stat_buf));
+  EXPECT_EQ(3 * PAGE_SIZE, stat_buf.st_size);
+  ASSERT_EQ(0, stat(file2.c_str(), &stat_buf));
+  EXPECT_EQ(5 * PAGE_SIZE, stat_buf.st_size);
+  EXPECT_TRUE(dm->ReadPage(first3 + 1, buf));
+  EXPECT_EQ(0, std::strcmp(("Page " + std::to_string(first3 + 1)).c_str(), buf + Page::SIZE_PAGE_HEADER));
+  EXPECT_TRUE(dm->ReadPage(1, buf));
+  EXPECT_EQ(0, std::strcmp("Page 1", buf + Page::SIZE_PAGE_HEADER));
+  dm->ShutDown();
+  delete dm;
+
+  // Scenario: a reopened tablespace keeps its pages and allocation state.
+  dm = new DiskManager(db_file);
+  EXPECT_THROW(dm->ReadPage(first2, buf), Exception);
+  dm->OpenTablespace(2);
+  EXPECT_TRUE(dm->IsAllocated(first2 + 3));
+  EXPECT_EQ(first2 + 4, dm->AllocateExtent(1, 2));
+  EXPECT_TRUE(dm->ReadPage(first2 + 1, buf));
+  EXPECT_EQ(0, std::strcmp(("Page " + std::to_string(first3 + 1)).c_str(), buf + Page::SIZE_PAGE_HEADER));
+
+  // Scenario: dropping a tablespace unlinks its file.
+  dm->DropTablespace(2);
+  EXPECT_FALSE(dm->HasTablespace(2));
+  EXPECT_FALSE(dm->IsAllocated(first2 + 3));
+  EXPECT_NE(0, access(file2.c_str(), F_OK));
+  dm->OpenTablespace(3, directory);
+  EXPECT_TRUE(dm->IsAllocated(first3 + 1));
+  dm->DropTablespace(3);
+  EXPECT_NE(0, access(file3.c_str(), F_OK));
+  dm->ShutDown();
+  delete dm;
+
+  // Scenario: a disk manager destroyed without ShutDown closes its data files.
+  size_t open_files = CountOpenFiles();
+  dm = new DiskManager(db_file);
+  std::string file4 = dm->OpenTablespace(4);
+  EXPECT_LT(open_files, CountOpenFiles());
+  delete dm;
+  EXPECT_EQ(open_files, CountOpenFiles());
+  remove(file4.c_str());
+  remove(db_file.c_str());
+  rmdir(directory.c_str());
+}
+
 TEST(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
 }  // namespace bustub
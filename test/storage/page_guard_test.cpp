@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard_test.cpp
+//
+// Identification: test/storage/page_guard_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/page/page_guard.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(PageGuardTest, SampleTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 5;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  page_id_t page_id;
+  Page *page;
+  {
+    BasicPageGuard guard = bpm->NewPageGuarded(&page_id);
+    ASSERT_EQ(true, guard.IsValid());
+    page = guard.GetPage();
+    EXPECT_EQ(page_id, guard.PageId());
+    EXPECT_EQ(1, page->GetPinCount());
+    snprintf(guard.GetDataMut(), PAGE_SIZE, "Hello");
+
+    // Scenario: moving a guard moves the pin; the moved-from guard is empty.
+    BasicPageGuard moved(std::move(guard));
+    EXPECT_EQ(false, guard.IsValid());  // NOLINT
+    EXPECT_EQ(1, page->GetPinCount());
+  }
+  // Scenario: the page is unpinned when the guard goes out of scope.
+  EXPECT_EQ(0, page->GetPinCount());
+  EXPECT_EQ(true, page->IsDirty());
+
+  // Scenario: read guards share the page, each with its own pin.
+  {
+    ReadPageGuard guard1 = bpm->FetchPageRead(page_id);
+    ReadPageGuard guard2 = bpm->FetchPageRead(page_id);
+    EXPECT_EQ(2, page->GetPinCount());
+    EXPECT_EQ(0, strcmp(guard1.GetData(), "Hello"));
+
+    // Scenario: assigning to a guard releases the page it held before.
+    guard1 = std::move(guard2);
+    EXPECT_EQ(1, page->GetPinCount());
+    guard1.Drop();
+    EXPECT_EQ(0, page->GetPinCount());
+  }
+
+  // Scenario: a write guard only dirties the page if it was modified through it.
+  EXPECT_EQ(true, bpm->FlushPage(page_id));
+  { WritePageGuard guard = bpm->FetchPageWrite(page_id); }
+  EXPECT_EQ(false, page->IsDirty());
+  {
+    WritePageGuard guard = bpm->FetchPageWrite(page_id);
+    snprintf(guard.GetDataMut(), PAGE_SIZE, "World");
+  }
+  EXPECT_EQ(true, page->IsDirty());
+  EXPECT_EQ(0, page->GetPinCount());
+
+  // Scenario: a basic guard can be upgraded; the pin moves into the latched guard.
+  {
+    BasicPageGuard guard = bpm->FetchPageBasic(page_id);
+    WritePageGuard write_guard = guard.UpgradeWrite();
+    EXPECT_EQ(false, guard.IsValid());  // NOLINT
+    EXPECT_EQ(1, page->GetPinCount());
+  }
+  EXPECT_EQ(0, page->GetPinCount());
+
+  // Scenario: guards of pages that could not be fetched are empty.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t temp_page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&temp_page_id));
+  }
+  EXPECT_EQ(false, bpm->FetchPageRead(page_id).IsValid());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -0,0 +1,73 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_test.cpp
+//
+// Identification: test/storage/page_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <cstring>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(PageTest, OptimisticReadTest) {
+  const int num_readers = 4;
+  const int num_writes = 10000;
+  Page page;
+
+  // The writer keeps every word of the first 64 bytes equal to each other.
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int i = 1; i <= num_writes; ++i) {
+      page.WLatch();
+      for (int j = 0; j < 16; ++j) {
+        memcpy(page.GetData() + j * sizeof(int), &i, sizeof(int));
+      }
+      page.WUnlatch();
+    }
+    done = true;
+  });
+
+  std::vector<std::thread> readers;
+  std::atomic<int> torn_reads{0};
+  for (int r = 0; r < num_readers; ++r) {
+    readers.emplace_back([&] {
+      int last = 0;
+      while (!done) {
+        int words[16];
+        int value = page.OptimisticRead([&] {
+          memcpy(words, page.GetData(), sizeof(words));
+          return words[0];
+        });
+        for (int word : words) {
+          if (word != value) {
+            torn_reads++;
+          }
+        }
+        // Reads never go back in time.
+        EXPECT_LE(last, value);
+        last = value;
+      }
+    });
+  }
+
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, torn_reads);
+  EXPECT_EQ(num_writes, page.OptimisticRead([&] { return *reinterpret_cast<int *>(page.GetData()); }));
+}
+
+}  // namespace bustub
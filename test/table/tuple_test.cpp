@@ -10,6 +10,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
+#include <unistd.h>
 #include <algorithm>
 #include <cstdio>
 #include <iostream>
@@ -21,6 +23,7 @@
 #include "logging/common.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/tuple.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 // NOLINTNEXTLINE
@@ -71,4 +74,101 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(TupleTest, MaxTupleSizeTest) {
+  Column col{"a", TypeId::VARCHAR, PAGE_SIZE};
+  Schema schema{std::vector<Column>{col}};
+  // The tuple of an empty string holds everything but the characters.
+  size_t base_size = Tuple{std::vector<Value>{ValueFactory::GetVarcharValue("")}, &schema}.GetLength();
+  auto make_tuple = [&schema, base_size](size_t tuple_size) {
+    std::string value(tuple_size - base_size, 'x');
+    Tuple tuple{std::vector<Value>{ValueFactory::GetVarcharValue(value)}, &schema};
+    EXPECT_EQ(tuple_size, tuple.GetLength());
+    return tuple;
+  };
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(10, disk_manager);
+  auto *table = new TableHeap(buffer_pool_manager, nullptr, nullptr, transaction);
+
+  RID rid;
+  Tuple largest = make_tuple(TablePage::MAX_TUPLE_SIZE);
+  EXPECT_TRUE(table->InsertTuple(largest, &rid, transaction));
+  Tuple result;
+  EXPECT_TRUE(table->GetTuple(rid, &result, transaction));
+  EXPECT_EQ(largest.GetLength(), result.GetLength());
+  EXPECT_EQ(0, memcmp(largest.GetData(), result.GetData(), largest.GetLength()));
+
+  EXPECT_FALSE(table->InsertTuple(make_tuple(TablePage::MAX_TUPLE_SIZE + 1), &rid, transaction));
+  EXPECT_EQ(TransactionState::ABORTED, transaction->GetState());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, CorruptPageTest) {
+  Column col{"a", TypeId::VARCHAR, PAGE_SIZE};
+  Schema schema{std::vector<Column>{col}};
+  // Each tuple fills a page of its own.
+  size_t base_size = Tuple{std::vector<Value>{ValueFactory::GetVarcharValue("")}, &schema}.GetLength();
+  std::string value(TablePage::MAX_TUPLE_SIZE - base_size, 'x');
+  Tuple tuple{std::vector<Value>{ValueFactory::GetVarcharValue(value)}, &schema};
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(10, disk_manager);
+  auto *table = new TableHeap(buffer_pool_manager, nullptr, nullptr, transaction);
+  std::vector<RID> rids(3);
+  for (auto &rid : rids) {
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, transaction));
+  }
+  buffer_pool_manager->FlushAllPages();
+  page_id_t first_page_id = table->GetFirstPageId();
+  delete table;
+  delete buffer_pool_manager;
+
+  // Damage the second page of the heap on disk; it lies behind the first free-space map.
+  int fd = open("test.db", O_RDWR);
+  ASSERT_GE(fd, 0);
+  off_t offset = (rids[1].GetPageId() + 1) * static_cast<off_t>(PAGE_SIZE) + PAGE_SIZE / 2;
+  char byte;
+  ASSERT_EQ(1, pread(fd, &byte, 1, offset));
+  byte ^= 1;
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, offset));
+  close(fd);
+
+  // Scenario: with a fresh buffer pool, reads of the damaged page fail instead of dereferencing an empty guard.
+  buffer_pool_manager = new BufferPoolManager(10, disk_manager);
+  table = new TableHeap(buffer_pool_manager, nullptr, nullptr, first_page_id);
+  Tuple result;
+  EXPECT_TRUE(table->GetTuple(rids[0], &result, transaction));
+  EXPECT_FALSE(table->GetTuple(rids[1], &result, transaction));
+  EXPECT_EQ(TransactionState::ABORTED, transaction->GetState());
+
+  // Scenario: a scan that runs into the damaged page ends there and aborts its transaction.
+  auto *scan_transaction = new Transaction(1);
+  size_t scanned = 0;
+  for (auto it = table->Begin(scan_transaction); it != table->End(); ++it) {
+    scanned++;
+  }
+  EXPECT_EQ(1, scanned);
+  EXPECT_EQ(TransactionState::ABORTED, scan_transaction->GetState());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete scan_transaction;
+  delete transaction;
+}
+
 }  // namespace bustub